@@ -3388,6 +3388,52 @@ static void test_delete_value(void)
     ok(res == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", res);
 }
 
+static void test_value_change_other_handle(void)
+{
+    HKEY hkey1, hkey2;
+    char buffer[16];
+    DWORD size, type;
+    LONG res;
+
+    res = RegCreateKeyExA( hkey_main, "Change", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &hkey1, NULL );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    res = RegOpenKeyExA( hkey_main, "Change", 0, KEY_QUERY_VALUE, &hkey2 );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+
+    res = RegQueryValueExA( hkey2, "test", NULL, NULL, NULL, NULL );
+    ok(res == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", res);
+
+    res = RegSetValueExA( hkey1, "test", 0, REG_SZ, (const BYTE *)"value1", 7 );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    size = sizeof(buffer);
+    res = RegQueryValueExA( hkey2, "test", NULL, &type, (BYTE *)buffer, &size );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    ok(type == REG_SZ, "got type %u\n", type);
+    ok(!strcmp( buffer, "value1" ), "got %s\n", buffer);
+
+    /* a change through another handle must be visible right away */
+    res = RegSetValueExA( hkey1, "test", 0, REG_SZ, (const BYTE *)"value22", 8 );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    size = sizeof(buffer);
+    res = RegQueryValueExA( hkey2, "test", NULL, &type, (BYTE *)buffer, &size );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    ok(size == 8, "got size %u\n", size);
+    ok(!strcmp( buffer, "value22" ), "got %s\n", buffer);
+
+    res = RegDeleteValueA( hkey1, "test" );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    res = RegQueryValueExA( hkey2, "test", NULL, NULL, NULL, NULL );
+    ok(res == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", res);
+
+    res = RegDeleteKeyA( hkey1, "" );
+    ok(res == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", res);
+    res = RegQueryValueExA( hkey2, "test", NULL, NULL, NULL, NULL );
+    ok(res == ERROR_KEY_DELETED, "expected ERROR_KEY_DELETED, got %d\n", res);
+
+    RegCloseKey( hkey1 );
+    RegCloseKey( hkey2 );
+}
+
 static void test_delete_key_value(void)
 {
     HKEY subkey;
@@ -3861,6 +3907,7 @@ START_TEST(registry)
     test_rw_order();
     test_deleted_key();
     test_delete_value();
+    test_value_change_other_handle();
     test_delete_key_value();
     test_RegOpenCurrentUser();
     test_RegNotifyChangeKeyValue();
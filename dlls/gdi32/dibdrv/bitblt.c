@@ -431,6 +431,170 @@ static const unsigned char BITBLT_Opcodes[256][MAX_OP_LEN] =
     { OP(PAT,DST,R2_WHITE) }                                        /* 0xff  1              */
 };
 
+/* operations covering fewer pixels than this aren't worth splitting */
+#define MIN_BAND_PIXELS (256 * 256)
+#define MIN_BAND_ROWS   16
+#define MAX_BANDS       16
+
+struct band_job
+{
+    band_func   func;
+    void       *arg;
+    int         top;
+    int         height;
+    int         count;     /* number of bands */
+    LONG        next;      /* next band to process */
+    LONG        pending;   /* number of bands not yet finished */
+    LONG        refcount;
+    HANDLE      done;
+};
+
+static unsigned int get_max_bands(void)
+{
+    static unsigned int max_bands;
+
+    if (!max_bands)
+    {
+        SYSTEM_INFO info;
+
+        GetSystemInfo( &info );
+        max_bands = max( 1, min( info.dwNumberOfProcessors, MAX_BANDS ));
+    }
+    return max_bands;
+}
+
+static void release_band_job( struct band_job *job )
+{
+    if (InterlockedDecrement( &job->refcount )) return;
+    CloseHandle( job->done );
+    HeapFree( GetProcessHeap(), 0, job );
+}
+
+static void run_bands( struct band_job *job )
+{
+    int band;
+
+    while ((band = InterlockedIncrement( &job->next ) - 1) < job->count)
+    {
+        job->func( job->arg, job->top + MulDiv( band, job->height, job->count ),
+                   job->top + MulDiv( band + 1, job->height, job->count ));
+        if (!InterlockedDecrement( &job->pending )) SetEvent( job->done );
+    }
+}
+
+static void CALLBACK band_callback( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct band_job *job = arg;
+
+    run_bands( job );
+    release_band_job( job );
+}
+
+/***********************************************************************
+ *           process_bands
+ *
+ * Call func on the rows from top to bottom.  Large operations are split
+ * into horizontal bands that are processed in parallel on the thread pool;
+ * func must only modify the destination rows it is passed.
+ */
+void process_bands( band_func func, void *arg, int top, int bottom, int width )
+{
+    struct band_job *job;
+    int i, count = min( get_max_bands(), (bottom - top) / MIN_BAND_ROWS );
+
+    if (count < 2 || (LONGLONG)(bottom - top) * width < MIN_BAND_PIXELS ||
+        !(job = HeapAlloc( GetProcessHeap(), 0, sizeof(*job) )))
+    {
+        func( arg, top, bottom );
+        return;
+    }
+    if (!(job->done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        HeapFree( GetProcessHeap(), 0, job );
+        func( arg, top, bottom );
+        return;
+    }
+
+    job->func     = func;
+    job->arg      = arg;
+    job->top      = top;
+    job->height   = bottom - top;
+    job->count    = count;
+    job->next     = 0;
+    job->pending  = count;
+    job->refcount = 1;
+
+    /* the calling thread takes its share of the bands too */
+    for (i = 1; i < count; i++)
+    {
+        InterlockedIncrement( &job->refcount );
+        if (TrySubmitThreadpoolCallback( band_callback, job, NULL )) continue;
+        InterlockedDecrement( &job->refcount );
+        break;
+    }
+
+    run_bands( job );
+    if (job->pending) WaitForSingleObject( job->done, INFINITE );
+    release_band_job( job );
+}
+
+struct solid_rects_args
+{
+    const dib_info *dib;
+    int             num;
+    const RECT     *rects;
+    DWORD           and;
+    DWORD           xor;
+};
+
+static void solid_rects_band( void *arg, int top, int bottom )
+{
+    const struct solid_rects_args *args = arg;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < args->num; i++)
+    {
+        rect = args->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top < rect.bottom && rect.left < rect.right)
+            args->dib->funcs->solid_rects( args->dib, 1, &rect, args->and, args->xor );
+    }
+}
+
+/***********************************************************************
+ *           fill_solid_rects
+ */
+void fill_solid_rects( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor )
+{
+    struct solid_rects_args args;
+    RECT bounds;
+    int i;
+
+    if (num < 1) return;
+    bounds = rects[0];
+    for (i = 1; i < num; i++)
+    {
+        bounds.left   = min( bounds.left, rects[i].left );
+        bounds.top    = min( bounds.top, rects[i].top );
+        bounds.right  = max( bounds.right, rects[i].right );
+        bounds.bottom = max( bounds.bottom, rects[i].bottom );
+    }
+    if ((LONGLONG)(bounds.bottom - bounds.top) * (bounds.right - bounds.left) < MIN_BAND_PIXELS)
+    {
+        dib->funcs->solid_rects( dib, num, rects, and, xor );
+        return;
+    }
+
+    args.dib   = dib;
+    args.num   = num;
+    args.rects = rects;
+    args.and   = and;
+    args.xor   = xor;
+    process_bands( solid_rects_band, &args, bounds.top, bounds.bottom, bounds.right - bounds.left );
+}
+
 static int get_overlap( const dib_info *dst, const RECT *dst_rect,
                         const dib_info *src, const RECT *src_rect )
 {
@@ -581,20 +745,57 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
-static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
-                         HRGN clip, BLENDFUNCTION blend )
+struct blend_rect_args
+{
+    const dib_info             *dst;
+    const RECT                 *dst_rect;
+    const dib_info             *src;
+    const RECT                 *src_rect;
+    const struct clipped_rects *clipped_rects;
+    BLENDFUNCTION               blend;
+};
+
+static void blend_rect_band( void *arg, int top, int bottom )
 {
+    const struct blend_rect_args *args = arg;
     POINT origin;
-    struct clipped_rects clipped_rects;
+    RECT rect;
     int i;
 
-    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < args->clipped_rects->count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        rect = args->clipped_rects->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top >= rect.bottom) continue;
+        origin.x = args->src_rect->left + rect.left - args->dst_rect->left;
+        origin.y = args->src_rect->top  + rect.top  - args->dst_rect->top;
+        args->dst->funcs->blend_rect( args->dst, &rect, args->src, &origin, args->blend );
     }
+}
+
+static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                         HRGN clip, BLENDFUNCTION blend )
+{
+    struct blend_rect_args args;
+    struct clipped_rects clipped_rects;
+    int top, bottom;
+
+    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+
+    args.dst           = dst;
+    args.dst_rect      = dst_rect;
+    args.src           = src;
+    args.src_rect      = src_rect;
+    args.clipped_rects = &clipped_rects;
+    args.blend         = blend;
+
+    top = clipped_rects.rects[0].top;
+    bottom = clipped_rects.rects[clipped_rects.count - 1].bottom;
+    /* bands could read rows that another band has already blended */
+    if (get_overlap( dst, dst_rect, src, src_rect )) blend_rect_band( &args, top, bottom );
+    else process_bands( blend_rect_band, &args, top, bottom, dst_rect->right - dst_rect->left );
+
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
 }
@@ -678,19 +879,53 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
-static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+struct gradient_rect_args
 {
+    const dib_info             *dib;
+    const TRIVERTEX            *v;
+    int                         mode;
+    const struct clipped_rects *clipped_rects;
+    BOOL                        ret;
+};
+
+static void gradient_rect_band( void *arg, int top, int bottom )
+{
+    struct gradient_rect_args *args = arg;
+    RECT rect;
     int i;
-    struct clipped_rects clipped_rects;
-    BOOL ret = TRUE;
 
-    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < args->clipped_rects->count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        rect = args->clipped_rects->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top >= rect.bottom) continue;
+        if (!args->dib->funcs->gradient_rect( args->dib, &rect, args->v, args->mode ))
+        {
+            args->ret = FALSE;
+            break;
+        }
     }
+}
+
+static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+{
+    struct gradient_rect_args args;
+    struct clipped_rects clipped_rects;
+
+    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
+
+    args.dib           = dib;
+    args.v             = v;
+    args.mode          = mode;
+    args.clipped_rects = &clipped_rects;
+    args.ret           = TRUE;
+
+    process_bands( gradient_rect_band, &args, clipped_rects.rects[0].top,
+                   clipped_rects.rects[clipped_rects.count - 1].bottom, bounds->right - bounds->left );
+
     free_clipped_rects( &clipped_rects );
-    return ret;
+    return args.ret;
 }
 
 static DWORD copy_src_bits( dib_info *src, RECT *src_rect )
@@ -1195,6 +1430,105 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_rows_args
+{
+    dib_info                    *dst_dib;
+    const dib_info              *src_dib;
+    POINT                        dst_start;
+    POINT                        src_start;
+    const struct stretch_params *v_params;
+    const struct stretch_params *h_params;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    int                          mode;
+    int                          width;
+};
+
+static inline BOOL next_stretch_row( const struct stretch_params *params, int *err )
+{
+    if (*err > 0)
+    {
+        *err += params->err_add_1;
+        return TRUE;
+    }
+    *err += params->err_add_2;
+    return FALSE;
+}
+
+/* Each step of a vertical stretch writes one destination row.  Rows that
+   repeat the previous source row are copied from the previous destination
+   row, except for the first row of a band which is always recomputed. */
+static void stretch_rows_band( void *arg, int start, int end )
+{
+    const struct stretch_rows_args *args = arg;
+    const struct stretch_params *v_params = args->v_params;
+    POINT dst_start = args->dst_start, src_start = args->src_start;
+    RECT last_row, this_row;
+    int i, err = v_params->err_start;
+    BOOL need_row = TRUE;
+
+    last_row.left = 0;
+    last_row.right = args->width;
+
+    for (i = 0; i < end; i++)
+    {
+        if (i == start || (i > start && need_row))
+        {
+            args->row_fn( args->dst_dib, &dst_start, args->src_dib, &src_start,
+                          args->h_params, args->mode, FALSE );
+            need_row = FALSE;
+        }
+        else if (i > start)
+        {
+            last_row.top = dst_start.y - v_params->dst_inc;
+            last_row.bottom = last_row.top + 1;
+            this_row = last_row;
+            offset_rect( &this_row, 0, v_params->dst_inc );
+            copy_rect( args->dst_dib, &this_row, args->dst_dib, &last_row, NULL, R2_COPYPEN );
+        }
+
+        if (next_stretch_row( v_params, &err ))
+        {
+            src_start.y += v_params->src_inc;
+            need_row = TRUE;
+        }
+        dst_start.y += v_params->dst_inc;
+    }
+}
+
+/* Each step of a vertical shrink merges one source row into the current
+   destination row.  A band starts at the first destination row beginning
+   at or after start, and ends where the first one at or after end begins. */
+static void shrink_rows_band( void *arg, int start, int end )
+{
+    const struct stretch_rows_args *args = arg;
+    const struct stretch_params *v_params = args->v_params;
+    POINT dst_start = args->dst_start, src_start = args->src_start;
+    int i, err = v_params->err_start, merged_rows = 0;
+    BOOL active = FALSE;
+
+    for (i = 0; i < v_params->length; i++)
+    {
+        if (!merged_rows)
+        {
+            if (i >= end) break;
+            active = (i >= start);
+        }
+        if (active && (args->mode != STRETCH_DELETESCANS || !merged_rows))
+            args->row_fn( args->dst_dib, &dst_start, args->src_dib, &src_start,
+                          args->h_params, args->mode, merged_rows != 0 );
+        merged_rows++;
+
+        if (next_stretch_row( v_params, &err ))
+        {
+            dst_start.y += v_params->dst_inc;
+            merged_rows = 0;
+        }
+        src_start.y += v_params->src_inc;
+    }
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1204,11 +1538,9 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_rows_args args;
+    band_func band;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1242,64 +1574,19 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
-    }
+    args.dst_dib   = &dst_dib;
+    args.src_dib   = &src_dib;
+    args.dst_start = dst_start;
+    args.src_start = src_start;
+    args.v_params  = &v_params;
+    args.h_params  = &h_params;
+    args.row_fn    = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    args.mode      = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    args.width     = dst->visrect.right - dst->visrect.left;
+
+    band = vstretch ? stretch_rows_band : shrink_rows_band;
+    if (src_bits == dst_bits) band( &args, 0, v_params.length );
+    else process_bands( band, &args, 0, v_params.length, args.width );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
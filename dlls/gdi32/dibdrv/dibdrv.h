@@ -260,6 +260,10 @@ extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
 extern void release_cached_font( struct cached_font *font ) DECLSPEC_HIDDEN;
 extern BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop ) DECLSPEC_HIDDEN;
 
+typedef void (*band_func)( void *arg, int top, int bottom );
+extern void process_bands( band_func func, void *arg, int top, int bottom, int width ) DECLSPEC_HIDDEN;
+extern void fill_solid_rects( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor ) DECLSPEC_HIDDEN;
+
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
     clip_rects->count = 0;
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include "gdi_private.h"
 #include "dibdrv.h"
+#include "winreg.h"
 
 #include "wine/unicode.h"
 #include "wine/debug.h"
@@ -43,6 +44,23 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* realized face of a font, used to match fonts in the shared glyph cache */
+struct shared_face
+{
+    DWORD         hash;
+    DWORD         index;        /* face index in the font file */
+    DWORD         simulations;  /* bold and oblique simulations */
+    DWORD         ppem;         /* em height in logical units */
+    LONG          width;
+    LONG          escapement;
+    LONG          orientation;
+    DWORD         vertical;     /* vertical writing ('@' face name) */
+    DWORD         charset;      /* realized charset, selects the cmap */
+    FILETIME      writetime;
+    LARGE_INTEGER size;
+    WCHAR         path[MAX_PATH];
+};
+
 struct cached_font
 {
     struct list           entry;
@@ -51,6 +69,10 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    LONG                  face_state;   /* 0 if not retrieved yet, 1 if valid, -1 if not shareable */
+    struct shared_face    face;         /* realized face, valid once face_state is 1 */
+    DWORD                 shared_font;  /* index in the shared font table + 1 */
+    DWORD                 shared_gen;   /* generation of the shared font entry */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
@@ -611,6 +633,8 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->face_state = 0;
+    ptr->shared_font = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
@@ -660,6 +684,492 @@ static struct cached_glyph *get_cached_glyph( struct cached_font *font, UINT ind
     return font->glyphs[type][page][index % GLYPH_CACHE_PAGE_SIZE];
 }
 
+/* Glyph bitmaps can also be shared between processes through a named section,
+ * so that processes rendering the same fonts don't all have to rasterize them.
+ * The section holds a table of fonts, identified by their realized face (font
+ * file, face index, simulations, em size, charset and vertical writing)
+ * rather than by LOGFONT, and
+ * fixed-size glyph slots in a few size classes, each class being managed as an
+ * LRU list.  Fonts that don't come from a file are never shared.  Everything in the section is protected
+ * by a named mutex; glyphs are copied into the process cache on a hit, so the
+ * section is only ever accessed with the mutex held.  Other processes can write
+ * anything there, so offsets and sizes are checked before being used.
+ *
+ * The cache is disabled unless HKCU\Software\Wine\Fonts\GlyphCacheSize is set
+ * to the size of the section in megabytes.
+ */
+
+#define SHARED_CACHE_VERSION   3
+#define SHARED_CACHE_FONTS     256
+#define SHARED_CACHE_BUCKETS   4096
+#define SHARED_CACHE_CLASSES   4
+#define SHARED_CACHE_MAX_SIZE  256  /* in megabytes */
+
+static const DWORD shared_slot_size[SHARED_CACHE_CLASSES] = { 256, 1024, 4096, 16384 };
+
+struct shared_font
+{
+    DWORD              generation;   /* incremented when the entry is reused for another font */
+    DWORD              last_used;
+    UINT               aa_flags;
+    XFORM              xform;
+    struct shared_face face;
+};
+
+struct shared_glyph
+{
+    DWORD        next;        /* offset of the next glyph in the hash bucket */
+    DWORD        lru_prev;    /* offset of the more recently used slot */
+    DWORD        lru_next;    /* offset of the less recently used slot */
+    DWORD        font;        /* index in the font table + 1, 0 if the slot is free */
+    DWORD        generation;  /* generation of the font entry */
+    DWORD        key;         /* glyph type and index */
+    DWORD        size;        /* size of the bitmap bits */
+    GLYPHMETRICS metrics;
+    BYTE         bits[1];
+};
+
+struct shared_class
+{
+    DWORD lru_head;   /* offset of the most recently used slot */
+    DWORD lru_tail;   /* offset of the least recently used slot */
+};
+
+struct shared_glyph_cache
+{
+    DWORD               version;
+    DWORD               size;       /* size of the section */
+    DWORD               clock;      /* font table use counter */
+    DWORD               hits;
+    DWORD               misses;
+    DWORD               evictions;
+    struct shared_class classes[SHARED_CACHE_CLASSES];
+    struct shared_font  fonts[SHARED_CACHE_FONTS];
+    DWORD               buckets[SHARED_CACHE_BUCKETS];
+};
+
+static struct shared_glyph_cache *shared_cache;
+static DWORD shared_cache_size;
+static HANDLE shared_cache_mutex;
+static BOOL shared_cache_init_done;
+
+static inline struct shared_glyph *get_shared_slot( DWORD offset )
+{
+    return (struct shared_glyph *)((char *)shared_cache + offset);
+}
+
+/* get the size class of a glyph slot from its offset, following the layout
+ * of init_shared_glyph_cache; returns -1 if the offset isn't a slot */
+static int get_shared_slot_class( DWORD offset )
+{
+    DWORD start, end, class_size;
+    int i;
+
+    start = (sizeof(*shared_cache) + 15) & ~15;
+    class_size = (shared_cache_size - start) / SHARED_CACHE_CLASSES;
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+    {
+        end = start + class_size / shared_slot_size[i] * shared_slot_size[i];
+        if (offset < end)
+        {
+            if (offset < start || (offset - start) % shared_slot_size[i]) return -1;
+            return i;
+        }
+        start = end;
+    }
+    return -1;
+}
+
+/* links read from the section are only followed if they point to a slot */
+static inline BOOL is_valid_slot_link( DWORD offset )
+{
+    return !offset || get_shared_slot_class( offset ) != -1;
+}
+
+static void lru_remove( struct shared_class *class, DWORD offset )
+{
+    struct shared_glyph *slot = get_shared_slot( offset );
+
+    if (!is_valid_slot_link( slot->lru_prev ) || !is_valid_slot_link( slot->lru_next )) return;
+    if (slot->lru_prev) get_shared_slot( slot->lru_prev )->lru_next = slot->lru_next;
+    else class->lru_head = slot->lru_next;
+    if (slot->lru_next) get_shared_slot( slot->lru_next )->lru_prev = slot->lru_prev;
+    else class->lru_tail = slot->lru_prev;
+}
+
+static void lru_add_head( struct shared_class *class, DWORD offset )
+{
+    struct shared_glyph *slot = get_shared_slot( offset );
+
+    slot->lru_prev = 0;
+    slot->lru_next = class->lru_head;
+    if (class->lru_head && is_valid_slot_link( class->lru_head ))
+        get_shared_slot( class->lru_head )->lru_prev = offset;
+    else class->lru_tail = offset;
+    class->lru_head = offset;
+}
+
+static void init_shared_glyph_cache(void)
+{
+    DWORD i, j, count, offset, class_size;
+
+    memset( shared_cache, 0, sizeof(*shared_cache) );
+    shared_cache->size = shared_cache_size;
+
+    offset = (sizeof(*shared_cache) + 15) & ~15;
+    class_size = (shared_cache_size - offset) / SHARED_CACHE_CLASSES;
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+    {
+        count = class_size / shared_slot_size[i];
+        for (j = 0; j < count; j++, offset += shared_slot_size[i])
+        {
+            get_shared_slot( offset )->font = 0;
+            lru_add_head( &shared_cache->classes[i], offset );
+        }
+    }
+    shared_cache->version = SHARED_CACHE_VERSION;
+}
+
+static DWORD get_shared_cache_option(void)
+{
+    static const WCHAR fonts_keyW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','F','o','n','t','s',0};
+    static const WCHAR glyph_cache_sizeW[] = {'G','l','y','p','h','C','a','c','h','e','S','i','z','e',0};
+    WCHAR buffer[16];
+    DWORD type, count = sizeof(buffer), size = 0;
+    HKEY hkey;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\Fonts */
+    if (RegOpenKeyExW( HKEY_CURRENT_USER, fonts_keyW, 0, KEY_READ, &hkey )) return 0;
+    if (!RegQueryValueExW( hkey, glyph_cache_sizeW, NULL, &type, (BYTE *)buffer, &count ) && type == REG_SZ)
+        size = min( atoiW( buffer ), SHARED_CACHE_MAX_SIZE );
+    RegCloseKey( hkey );
+    return size * 1024 * 1024;
+}
+
+/* must be called with font_cache_cs held */
+static void open_shared_glyph_cache(void)
+{
+    static const WCHAR sectionW[] = {'_','_','w','i','n','e','_','g','l','y','p','h','_','c','a','c','h','e',0};
+    static const WCHAR mutexW[] = {'_','_','w','i','n','e','_','g','l','y','p','h','_','c','a','c','h','e','_',
+                                   'm','u','t','e','x',0};
+    struct shared_glyph_cache *cache;
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE mapping, mutex;
+    DWORD size;
+
+    shared_cache_init_done = TRUE;
+    if (!(size = get_shared_cache_option())) return;
+
+    if (!(mutex = CreateMutexW( NULL, FALSE, mutexW ))) return;
+    if (!(mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, sectionW )))
+    {
+        CloseHandle( mutex );
+        return;
+    }
+    cache = MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!cache)
+    {
+        CloseHandle( mutex );
+        return;
+    }
+    /* the section may have been created by another process with a different size */
+    if (!VirtualQuery( cache, &info, sizeof(info) ) || info.RegionSize < size)
+    {
+        WARN( "shared glyph cache section is too small\n" );
+        UnmapViewOfFile( cache );
+        CloseHandle( mutex );
+        return;
+    }
+
+    WaitForSingleObject( mutex, INFINITE );
+    shared_cache = cache;
+    shared_cache_size = size;
+    if (!cache->version) init_shared_glyph_cache();
+    ReleaseMutex( mutex );
+
+    if (cache->version != SHARED_CACHE_VERSION || cache->size != size)
+    {
+        WARN( "incompatible shared glyph cache version %u size %u\n", cache->version, cache->size );
+        UnmapViewOfFile( cache );
+        CloseHandle( mutex );
+        shared_cache = NULL;
+        return;
+    }
+    TRACE( "using shared glyph cache %p size %u\n", cache, cache->size );
+    shared_cache_mutex = mutex;
+}
+
+static BOOL is_shared_glyph_cache_enabled(void)
+{
+    if (!shared_cache_init_done)
+    {
+        EnterCriticalSection( &font_cache_cs );
+        if (!shared_cache_init_done) open_shared_glyph_cache();
+        LeaveCriticalSection( &font_cache_cs );
+    }
+    return shared_cache_mutex != NULL;
+}
+
+static BOOL lock_shared_glyph_cache(void)
+{
+    if (!is_shared_glyph_cache_enabled()) return FALSE;
+
+    switch (WaitForSingleObject( shared_cache_mutex, INFINITE ))
+    {
+    case WAIT_OBJECT_0:
+        return TRUE;
+    case WAIT_ABANDONED:
+        /* another process died while updating the cache, start over */
+        WARN( "resetting shared glyph cache\n" );
+        init_shared_glyph_cache();
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static inline void unlock_shared_glyph_cache(void)
+{
+    ReleaseMutex( shared_cache_mutex );
+}
+
+/***********************************************************************
+ *         get_shared_face
+ *
+ * Retrieve the realized face of the font selected in the DC, which is what
+ * identifies the font in the shared cache.  Returns FALSE if the font can't
+ * be shared, for instance for memory fonts.
+ */
+static BOOL get_shared_face( DC *dc, struct cached_font *font )
+{
+    struct font_realization_info info;
+    struct
+    {
+        struct font_fileinfo info;
+        WCHAR                path[MAX_PATH];
+    } file;
+    struct shared_face face;
+    TEXTMETRICW tm;
+    WCHAR name[LF_FACESIZE];
+    DWORD needed, *ptr;
+
+    if (font->face_state) return font->face_state > 0;
+
+    info.size = sizeof(info);
+    if (!GetFontRealizationInfo( dc->hSelf, &info ) ||
+        !GetFontFileInfo( info.instance_id, 0, &file.info, sizeof(file), &needed ) ||
+        !file.info.path[0] || strlenW( file.info.path ) >= MAX_PATH ||
+        !GetTextMetricsW( dc->hSelf, &tm ) || !GetTextFaceW( dc->hSelf, LF_FACESIZE, name ))
+    {
+        TRACE( "%s can't be shared\n", debugstr_w(font->lf.lfFaceName) );
+        font->face_state = -1;
+        return FALSE;
+    }
+
+    memset( &face, 0, sizeof(face) );
+    face.index       = info.face_index;
+    face.simulations = info.simulations;
+    face.ppem        = tm.tmHeight - tm.tmInternalLeading;
+    face.width       = font->lf.lfWidth;
+    face.escapement  = font->lf.lfEscapement;
+    face.orientation = font->lf.lfOrientation;
+    face.vertical    = (name[0] == '@');
+    face.charset     = tm.tmCharSet;
+    face.writetime   = file.info.writetime;
+    face.size        = file.info.size;
+    strcpyW( face.path, file.info.path );
+    for (ptr = &face.index; ptr < (DWORD *)(&face + 1); ptr++) face.hash = face.hash * 31 + *ptr;
+
+    font->face = face;
+    InterlockedExchange( &font->face_state, 1 );
+    return TRUE;
+}
+
+static int shared_font_cmp( const struct cached_font *font, const struct shared_font *shared )
+{
+    int ret = font->face.hash - shared->face.hash;
+    if (!ret) ret = font->aa_flags - shared->aa_flags;
+    if (!ret) ret = memcmp( &font->xform, &shared->xform, sizeof(font->xform) );
+    if (!ret) ret = memcmp( &font->face, &shared->face, sizeof(font->face) );
+    return ret;
+}
+
+/* find the shared font table entry for a font, optionally creating it; must be called with the mutex held */
+static struct shared_font *find_shared_font( struct cached_font *font, BOOL create )
+{
+    struct shared_font *shared, *oldest = NULL;
+    DWORD i;
+
+    if (font->shared_font)
+    {
+        shared = &shared_cache->fonts[font->shared_font - 1];
+        if (shared->generation == font->shared_gen && !shared_font_cmp( font, shared )) goto done;
+    }
+
+    for (i = 0; i < SHARED_CACHE_FONTS; i++)
+    {
+        shared = &shared_cache->fonts[i];
+        if (shared->last_used && !shared_font_cmp( font, shared )) goto found;
+        if (!oldest || shared->last_used < oldest->last_used) oldest = shared;
+    }
+    if (!create) return NULL;
+
+    /* glyphs of the previous font are ignored because of the new generation,
+     * they will get recycled through the LRU lists */
+    shared = oldest;
+    shared->generation++;
+    shared->aa_flags = font->aa_flags;
+    shared->xform    = font->xform;
+    shared->face     = font->face;
+
+found:
+    font->shared_font = shared - shared_cache->fonts + 1;
+    font->shared_gen  = shared->generation;
+done:
+    shared->last_used = ++shared_cache->clock;
+    return shared;
+}
+
+static inline DWORD shared_glyph_key( UINT index, UINT flags )
+{
+    return (flags & ETO_GLYPH_INDEX) ? (0x10000 | index) : index;
+}
+
+static inline DWORD *get_shared_bucket( DWORD font, DWORD generation, DWORD key )
+{
+    DWORD hash = (font * 0x9e3779b1) ^ (generation * 0x85ebca6b) ^ (key * 0xc2b2ae35);
+    return &shared_cache->buckets[(hash ^ (hash >> 16)) % SHARED_CACHE_BUCKETS];
+}
+
+static DWORD find_shared_glyph( const struct cached_font *font, DWORD key )
+{
+    DWORD offset = *get_shared_bucket( font->shared_font, font->shared_gen, key );
+    struct shared_glyph *slot;
+
+    int class;
+
+    while (offset)
+    {
+        if ((class = get_shared_slot_class( offset )) == -1) break;
+        slot = get_shared_slot( offset );
+        if (slot->font == font->shared_font && slot->generation == font->shared_gen && slot->key == key)
+        {
+            if (slot->size > shared_slot_size[class] - FIELD_OFFSET( struct shared_glyph, bits )) break;
+            return offset;
+        }
+        offset = slot->next;
+    }
+    if (offset) WARN( "corrupted shared glyph slot %08x\n", offset );
+    return 0;
+}
+
+static void remove_shared_glyph( DWORD offset )
+{
+    struct shared_glyph *slot = get_shared_slot( offset );
+    DWORD *ptr = get_shared_bucket( slot->font, slot->generation, slot->key );
+
+    while (*ptr && *ptr != offset && is_valid_slot_link( *ptr )) ptr = &get_shared_slot( *ptr )->next;
+    if (*ptr == offset) *ptr = slot->next;
+    slot->font = 0;
+}
+
+static int get_shared_class( DWORD size )
+{
+    int i;
+
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+        if (FIELD_OFFSET( struct shared_glyph, bits[size] ) <= shared_slot_size[i]) return i;
+    return -1;
+}
+
+/***********************************************************************
+ *         get_shared_glyph
+ *
+ * Retrieve a copy of a glyph from the shared cache.
+ */
+static struct cached_glyph *get_shared_glyph( struct cached_font *font, UINT index, UINT flags )
+{
+    struct cached_glyph *glyph = NULL;
+    struct shared_glyph *slot;
+    DWORD offset, key = shared_glyph_key( index, flags );
+
+    if (!lock_shared_glyph_cache()) return NULL;
+
+    /* find_shared_glyph checked that the glyph fits in its slot */
+    if (find_shared_font( font, FALSE ) && (offset = find_shared_glyph( font, key )))
+    {
+        slot = get_shared_slot( offset );
+        if ((glyph = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct cached_glyph, bits[slot->size] ))))
+        {
+            struct shared_class *class = &shared_cache->classes[get_shared_slot_class( offset )];
+
+            glyph->metrics = slot->metrics;
+            memcpy( glyph->bits, slot->bits, slot->size );
+            lru_remove( class, offset );
+            lru_add_head( class, offset );
+        }
+    }
+    if (glyph) shared_cache->hits++;
+    else shared_cache->misses++;
+
+    unlock_shared_glyph_cache();
+    return glyph;
+}
+
+/***********************************************************************
+ *         put_shared_glyph
+ *
+ * Store a newly rasterized glyph in the shared cache, recycling the least
+ * recently used slot of the appropriate size.
+ */
+static void put_shared_glyph( struct cached_font *font, UINT index, UINT flags,
+                              const struct cached_glyph *glyph, DWORD size )
+{
+    struct shared_class *class;
+    struct shared_glyph *slot;
+    DWORD offset, *bucket, key = shared_glyph_key( index, flags );
+    int class_index;
+
+    if ((class_index = get_shared_class( size )) == -1) return;
+    if (!lock_shared_glyph_cache()) return;
+
+    class = &shared_cache->classes[class_index];
+    if (!find_shared_font( font, TRUE ) || find_shared_glyph( font, key ) || !(offset = class->lru_tail))
+        goto done;
+    if (get_shared_slot_class( offset ) != class_index)
+    {
+        WARN( "corrupted shared glyph slot %08x\n", offset );
+        goto done;
+    }
+
+    slot = get_shared_slot( offset );
+    if (slot->font)
+    {
+        remove_shared_glyph( offset );
+        shared_cache->evictions++;
+    }
+
+    slot->font       = font->shared_font;
+    slot->generation = font->shared_gen;
+    slot->key        = key;
+    slot->size       = size;
+    slot->metrics    = glyph->metrics;
+    memcpy( slot->bits, glyph->bits, size );
+
+    bucket = get_shared_bucket( slot->font, slot->generation, key );
+    slot->next = *bucket;
+    *bucket = offset;
+    lru_remove( class, offset );
+    lru_add_head( class, offset );
+
+    TRACE( "hits %u misses %u evictions %u\n",
+           shared_cache->hits, shared_cache->misses, shared_cache->evictions );
+
+done:
+    unlock_shared_glyph_cache();
+}
+
 /**********************************************************************
  *                 get_text_bkgnd_masks
  *
@@ -756,6 +1266,10 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     int pad = 0, stride, bit_count;
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
+    BOOL shared = is_shared_glyph_cache_enabled() && get_shared_face( dc, font );
+
+    if (shared && (glyph = get_shared_glyph( font, index, flags )))
+        return add_cached_glyph( font, index, flags, glyph );
 
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
@@ -805,6 +1319,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
+    if (shared) put_shared_glyph( font, index, flags, glyph, size );
     return add_cached_glyph( font, index, flags, glyph );
 }
 
@@ -1196,7 +1711,7 @@ BOOL dibdrv_PatBlt( PHYSDEV dev, struct bitblt_coords *dst, DWORD rop )
     case R2_WHITE: xor = ~0u;
         /* fall through */
     case R2_BLACK:
-        pdev->dib.funcs->solid_rects( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
+        fill_solid_rects( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
         /* fall through */
     case R2_NOP:
         break;
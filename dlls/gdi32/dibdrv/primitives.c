@@ -19,6 +19,9 @@
  */
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "gdi_private.h"
 #include "dibdrv.h"
@@ -4651,31 +4654,132 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+
+/* The SSE2 helpers below process four pixels at a time with each channel widened
+ * to 16 bits, and return the number of pixels handled so that the caller can
+ * finish the row with the scalar code.  They must produce exactly the same
+ * results as the scalar versions above. */
+
+/* (x + 127) / 255 for 0 <= x <= 255 * 255 */
+static inline __m128i div255_epu16( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 128 ));
+    return _mm_srli_epi16( _mm_add_epi16( x, _mm_srli_epi16( x, 8 )), 8 );
+}
+
+static inline __m128i alpha_epu16( __m128i x )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, 0xff ), 0xff );
+}
+
+static inline __m128i blend_argb_epu16( __m128i dst, __m128i src )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha_epu16( src ));
+    return _mm_add_epi16( src, div255_epu16( _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static inline __m128i blend_color_epu16( __m128i dst, __m128i src, __m128i alpha, __m128i inv_alpha )
+{
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static int blend_argb_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i const_alpha = _mm_set1_epi16( alpha );
+    int i, x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s_lo = _mm_unpacklo_epi8( s, zero ), s_hi = _mm_unpackhi_epi8( s, zero );
+        __m128i lo, hi;
+
+        if (alpha != 255)
+        {
+            s_lo = div255_epu16( _mm_mullo_epi16( s_lo, const_alpha ));
+            s_hi = div255_epu16( _mm_mullo_epi16( s_hi, const_alpha ));
+        }
+        lo = blend_argb_epu16( _mm_unpacklo_epi8( d, zero ), s_lo );
+        hi = blend_argb_epu16( _mm_unpackhi_epi8( d, zero ), s_hi );
+
+        /* source colors that aren't premultiplied can overflow into the next
+         * channel, leave it to the scalar code to reproduce that exactly */
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( _mm_srli_epi16( _mm_or_si128( lo, hi ), 8 ), zero )) != 0xffff)
+        {
+            for (i = x; i < x + 4; i++)
+                dst[i] = alpha == 255 ? blend_argb( dst[i], src[i] ) : blend_argb_alpha( dst[i], src[i], alpha );
+            continue;
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+static int blend_argb_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha, BOOL src_alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i const_alpha = _mm_set1_epi16( alpha );
+    const __m128i inv_alpha = _mm_set1_epi16( 255 - alpha );
+    const __m128i alpha_mask = _mm_set1_epi32( src_alpha ? 0 : 0xff000000 );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), alpha_mask );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_color_epu16( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ),
+                                        const_alpha, inv_alpha );
+        __m128i hi = blend_color_epu16( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ),
+                                        const_alpha, inv_alpha );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+#else  /* __SSE2__ */
+
+static inline int blend_argb_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    return 0;
+}
+
+static inline int blend_argb_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha, BOOL src_alpha )
+{
+    return 0;
+}
+
+#endif  /* __SSE2__ */
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, width = rc->right - rc->left;
 
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_sse2( dst_ptr, src_ptr, width, 255 ); x < width; x++)
 		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_sse2( dst_ptr, src_ptr, width, blend.SourceConstantAlpha ); x < width; x++)
 		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_argb_constant_alpha_sse2( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, TRUE );
+                 x < width; x++)
 		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     else
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_argb_constant_alpha_sse2( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, FALSE );
+                 x < width; x++)
 		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
 }
 
@@ -386,12 +386,6 @@ typedef struct {
     GdiFont *font;
 } CHILD_FONT;
 
-struct font_fileinfo {
-    FILETIME writetime;
-    LARGE_INTEGER size;
-    WCHAR path[1];
-};
-
 struct tagGdiFont {
     struct list entry;
     struct list unused_entry;
@@ -1917,12 +1911,10 @@ static void get_family_names( FT_Face ft_face, WCHAR **name, WCHAR **english, BO
     }
 }
 
-static Family *get_family( FT_Face ft_face, BOOL vertical )
+/* takes ownership of the names */
+static Family *get_family_from_names( WCHAR *name, WCHAR *english_name )
 {
     Family *family;
-    WCHAR *name, *english_name;
-
-    get_family_names( ft_face, &name, &english_name, vertical );
 
     family = find_family_from_name( name );
 
@@ -2133,15 +2125,8 @@ static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file,
     return face;
 }
 
-static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          FT_Long face_index, DWORD flags )
+static void add_face( Face *face, Family *family, DWORD flags )
 {
-    Face *face;
-    Family *family;
-
-    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
-    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
-
     if (insert_face_in_family_list( face, family ))
     {
         if (flags & ADDFONT_ADD_TO_CACHE)
@@ -2154,6 +2139,500 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
     release_family( family );
 }
 
+/* The faces found in each font file while building the font list are saved
+ * in an index file in the Wine config dir, so that the next time the list
+ * has to be built from scratch only the files that have been modified since
+ * need to be loaded through FreeType.  The index is a sequence of file
+ * entries, each followed by the faces that AddFontToList added for it. */
+
+#define FONT_INDEX_MAGIC    0x58444e49  /* "INDX" */
+#define FONT_INDEX_VERSION  2
+#define FONT_INDEX_ALIGN(size) (((size) + 7) & ~7)
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD ft_version;
+    LCID  lcid;
+    DWORD langid;
+    DWORD acp;
+    DWORD count;     /* number of file entries */
+    DWORD reserved;
+};
+
+struct font_index_file
+{
+    DWORD     size;        /* size of the entry, including its faces */
+    DWORD     flags;       /* ADDFONT_ALLOW_BITMAP */
+    ULONGLONG mtime;
+    DWORD     mtime_nsec;  /* nanoseconds part of the modification time */
+    INT       ret;         /* AddFontToList return value */
+    ULONGLONG file_size;
+    ULONGLONG ino;
+    DWORD     name_len;    /* length of the unix file name that follows */
+    DWORD     reserved;
+};
+
+struct font_index_face
+{
+    DWORD         flags;   /* ADDFONT_VERTICAL_FONT */
+    LONG          face_index;
+    DWORD         ntm_flags;
+    LONG          font_version;
+    DWORD         scalable;
+    FONTSIGNATURE fs;
+    LONG          height;
+    LONG          width;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    LONG          internal_leading;
+    /* followed by the family, english family, style and full names */
+};
+
+struct font_index
+{
+    char                           *path;
+    const char                     *data;      /* mapped previous index */
+    size_t                          data_size;
+    const struct font_index_file  **entries;   /* hash table of the previous entries */
+    BOOL                           *used;      /* whether each entry has been reused */
+    unsigned int                    mask;
+    unsigned int                    count;     /* number of previous entries */
+    unsigned int                    reused;    /* number of previous entries reused */
+    BOOL                            changed;
+    BYTE                           *buffer;    /* new index */
+    size_t                          len;
+    size_t                          buffer_size;
+    size_t                          file_pos;  /* position of the entry being recorded, or 0 */
+    unsigned int                    new_count;
+};
+
+static struct font_index *font_index;
+
+static inline DWORD get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static unsigned int hash_font_path( const char *path )
+{
+    unsigned int hash = 0;
+    while (*path) hash = hash * 31 + (unsigned char)*path++;
+    return hash;
+}
+
+static BOOL font_index_append( const void *data, size_t size )
+{
+    size_t pad = FONT_INDEX_ALIGN( size );
+
+    if (font_index->len + pad > font_index->buffer_size)
+    {
+        size_t new_size = max( font_index->buffer_size * 2, font_index->len + pad + 4096 );
+        BYTE *new_buffer;
+
+        if (font_index->buffer) new_buffer = HeapReAlloc( GetProcessHeap(), 0, font_index->buffer, new_size );
+        else new_buffer = HeapAlloc( GetProcessHeap(), 0, new_size );
+
+        if (!new_buffer) return FALSE;
+        font_index->buffer = new_buffer;
+        font_index->buffer_size = new_size;
+    }
+    memcpy( font_index->buffer + font_index->len, data, size );
+    memset( font_index->buffer + font_index->len + size, 0, pad - size );
+    font_index->len += pad;
+    return TRUE;
+}
+
+static BOOL font_index_append_string( const WCHAR *str )
+{
+    DWORD len = str ? strlenW( str ) + 1 : 0;
+    DWORD buffer[128], *data = buffer;
+    BOOL ret;
+
+    if (sizeof(len) + len * sizeof(WCHAR) > sizeof(buffer) &&
+        !(data = HeapAlloc( GetProcessHeap(), 0, sizeof(len) + len * sizeof(WCHAR) )))
+        return FALSE;
+    data[0] = len;
+    memcpy( data + 1, str, len * sizeof(WCHAR) );
+    ret = font_index_append( data, sizeof(len) + len * sizeof(WCHAR) );
+    if (data != buffer) HeapFree( GetProcessHeap(), 0, data );
+    return ret;
+}
+
+/* retrieve a string from a face entry, advancing the pointer */
+static BOOL font_index_get_string( const char **ptr, const char *end, const WCHAR **str )
+{
+    DWORD len;
+
+    if (end - *ptr < sizeof(len)) return FALSE;
+    memcpy( &len, *ptr, sizeof(len) );
+    if (len > (end - *ptr - sizeof(len)) / sizeof(WCHAR)) return FALSE;
+    *str = len ? (const WCHAR *)(*ptr + sizeof(len)) : NULL;
+    if (len && (*str)[len - 1]) return FALSE;
+    *ptr += FONT_INDEX_ALIGN( sizeof(len) + len * sizeof(WCHAR) );
+    if (*ptr > end) *ptr = end;
+    return TRUE;
+}
+
+static char *get_font_index_path(void)
+{
+    static const char name[] = "/fontindex";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if ((path = HeapAlloc( GetProcessHeap(), 0, strlen( config_dir ) + sizeof(name) )))
+    {
+        strcpy( path, config_dir );
+        strcat( path, name );
+    }
+    return path;
+}
+
+static void fill_font_index_header( struct font_index_header *header )
+{
+    header->magic      = FONT_INDEX_MAGIC;
+    header->version    = FONT_INDEX_VERSION;
+    header->ft_version = FT_SimpleVersion;
+    header->lcid       = GetSystemDefaultLCID();
+    header->langid     = GetSystemDefaultLangID();
+    header->acp        = GetACP();
+    header->count      = 0;
+    header->reserved   = 0;
+}
+
+static const struct font_index_file *find_font_index_entry( const char *file, unsigned int *index )
+{
+    const struct font_index_file *entry;
+    unsigned int pos;
+
+    if (!font_index->entries) return NULL;
+    pos = hash_font_path( file ) & font_index->mask;
+    while ((entry = font_index->entries[pos]))
+    {
+        if (!strcmp( (const char *)(entry + 1), file )) break;
+        pos = (pos + 1) & font_index->mask;
+    }
+    *index = pos;
+    return entry;
+}
+
+static void load_font_index_entries(void)
+{
+    struct font_index_header header, expect;
+    const struct font_index_file *entry;
+    const char *ptr, *end;
+    unsigned int i;
+
+    if (font_index->data_size < sizeof(header)) return;
+    memcpy( &header, font_index->data, sizeof(header) );
+    fill_font_index_header( &expect );
+    expect.count = header.count;
+    if (memcmp( &header, &expect, sizeof(header) ) ||
+        header.count > font_index->data_size / sizeof(struct font_index_file))
+    {
+        TRACE( "ignoring outdated font index\n" );
+        return;
+    }
+
+    for (font_index->mask = 63; font_index->mask < header.count * 2; font_index->mask = font_index->mask * 2 + 1)
+        ;
+    if (!(font_index->entries = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                           (font_index->mask + 1) * sizeof(*font_index->entries) )) ||
+        !(font_index->used = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                        (font_index->mask + 1) * sizeof(*font_index->used) )))
+    {
+        HeapFree( GetProcessHeap(), 0, font_index->entries );
+        font_index->entries = NULL;
+        return;
+    }
+
+    ptr = font_index->data + sizeof(header);
+    end = font_index->data + font_index->data_size;
+    for (i = 0; i < header.count; i++)
+    {
+        unsigned int pos;
+
+        entry = (const struct font_index_file *)ptr;
+        if (end - ptr < sizeof(*entry) || entry->size > end - ptr || entry->size % 8 ||
+            entry->name_len >= entry->size ||
+            entry->size < sizeof(*entry) + FONT_INDEX_ALIGN( entry->name_len + 1 ) ||
+            ptr[sizeof(*entry) + entry->name_len]) break;
+        ptr += entry->size;
+        if (find_font_index_entry( (const char *)(entry + 1), &pos )) continue;  /* duplicate */
+        font_index->entries[pos] = entry;
+        font_index->count++;
+    }
+    TRACE( "loaded %u entries from font index\n", font_index->count );
+}
+
+/***********************************************************************
+ *           open_font_index
+ *
+ * Map the font index left by a previous session, and start recording a
+ * new one.
+ */
+static void open_font_index(void)
+{
+    struct font_index_header header;
+    struct stat st;
+    int fd;
+
+    if (!(font_index = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*font_index) ))) return;
+    if (!(font_index->path = get_font_index_path()))
+    {
+        HeapFree( GetProcessHeap(), 0, font_index );
+        font_index = NULL;
+        return;
+    }
+
+    if ((fd = open( font_index->path, O_RDONLY )) != -1)
+    {
+        if (!fstat( fd, &st ) && st.st_size >= sizeof(header) && st.st_size <= 0x7fffffff)
+        {
+            font_index->data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if (font_index->data == MAP_FAILED) font_index->data = NULL;
+            else font_index->data_size = st.st_size;
+        }
+        close( fd );
+    }
+    if (font_index->data) load_font_index_entries();
+
+    fill_font_index_header( &header );
+    font_index_append( &header, sizeof(header) );
+}
+
+/***********************************************************************
+ *           close_font_index
+ *
+ * Write the new font index if anything changed.
+ */
+static void close_font_index(void)
+{
+    struct font_index_header *header;
+    char *tmp;
+    int fd;
+
+    if (!font_index) return;
+
+    if ((font_index->changed || font_index->reused != font_index->count) && font_index->buffer &&
+        (tmp = HeapAlloc( GetProcessHeap(), 0, strlen( font_index->path ) + sizeof(".XXXXXX") )))
+    {
+        header = (struct font_index_header *)font_index->buffer;
+        header->count = font_index->new_count;
+        /* other processes may be rebuilding the font list at the same time,
+         * so each one writes its own file and atomically replaces the index */
+        strcpy( tmp, font_index->path );
+        strcat( tmp, ".XXXXXX" );
+        if ((fd = mkstemps( tmp, 0 )) != -1)
+        {
+            BOOL ok = (write( fd, font_index->buffer, font_index->len ) == font_index->len);
+            close( fd );
+            if (!ok || rename( tmp, font_index->path ) == -1)
+            {
+                WARN( "failed to write %s\n", debugstr_a(font_index->path) );
+                unlink( tmp );
+            }
+            else TRACE( "wrote %u entries to font index\n", font_index->new_count );
+        }
+        HeapFree( GetProcessHeap(), 0, tmp );
+    }
+
+    if (font_index->data) munmap( (void *)font_index->data, font_index->data_size );
+    HeapFree( GetProcessHeap(), 0, font_index->entries );
+    HeapFree( GetProcessHeap(), 0, font_index->used );
+    HeapFree( GetProcessHeap(), 0, font_index->buffer );
+    HeapFree( GetProcessHeap(), 0, font_index->path );
+    HeapFree( GetProcessHeap(), 0, font_index );
+    font_index = NULL;
+}
+
+static BOOL add_faces_from_index( const struct font_index_file *entry, const char *file,
+                                  const struct stat *st, DWORD flags )
+{
+    const char *ptr = (const char *)(entry + 1) + FONT_INDEX_ALIGN( entry->name_len + 1 );
+    const char *end = (const char *)entry + entry->size;
+    const WCHAR *family_name, *english_name, *style_name, *full_name;
+    struct font_index_face rec;
+    Face *face;
+
+    /* validate the whole entry first so that we don't add only some of the faces */
+    while (ptr < end)
+    {
+        if (end - ptr < FONT_INDEX_ALIGN( sizeof(rec) )) return FALSE;
+        ptr += FONT_INDEX_ALIGN( sizeof(rec) );
+        if (!font_index_get_string( &ptr, end, &family_name ) || !family_name ||
+            !font_index_get_string( &ptr, end, &english_name ) ||
+            !font_index_get_string( &ptr, end, &style_name ) || !style_name ||
+            !font_index_get_string( &ptr, end, &full_name ))
+            return FALSE;
+    }
+
+    ptr = (const char *)(entry + 1) + FONT_INDEX_ALIGN( entry->name_len + 1 );
+    while (ptr < end)
+    {
+        DWORD face_flags;
+
+        memcpy( &rec, ptr, sizeof(rec) );
+        ptr += FONT_INDEX_ALIGN( sizeof(rec) );
+        font_index_get_string( &ptr, end, &family_name );
+        font_index_get_string( &ptr, end, &english_name );
+        font_index_get_string( &ptr, end, &style_name );
+        font_index_get_string( &ptr, end, &full_name );
+
+        face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+        face->refcount         = 1;
+        face->StyleName        = strdupW( style_name );
+        face->FullName         = full_name ? strdupW( full_name ) : NULL;
+        face->file             = towstr( CP_UNIXCP, file );
+        face->dev              = st->st_dev;
+        face->ino              = st->st_ino;
+        face->font_data_ptr    = NULL;
+        face->font_data_size   = 0;
+        face->face_index       = rec.face_index;
+        face->fs               = rec.fs;
+        face->ntmFlags         = rec.ntm_flags;
+        face->font_version     = rec.font_version;
+        face->scalable         = rec.scalable;
+        face->size.height      = rec.height;
+        face->size.width       = rec.width;
+        face->size.size        = rec.size;
+        face->size.x_ppem      = rec.x_ppem;
+        face->size.y_ppem      = rec.y_ppem;
+        face->size.internal_leading = rec.internal_leading;
+        face->family           = NULL;
+        face->cached_enum_data = NULL;
+
+        face_flags = flags | (rec.flags & ADDFONT_VERTICAL_FONT);
+        if (!HIWORD( face_flags )) face_flags |= ADDFONT_AA_FLAGS( default_aa_flags );
+        face->flags = face_flags;
+
+        add_face( face, get_family_from_names( strdupW( family_name ), english_name ? strdupW( english_name ) : NULL ),
+                  face_flags );
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           load_font_from_index
+ *
+ * Add the faces of a font file from the index if it hasn't changed since
+ * it was indexed.  Otherwise start recording a new entry for it.
+ */
+static BOOL load_font_from_index( const char *file, DWORD flags, INT *ret )
+{
+    const struct font_index_file *entry;
+    struct font_index_file new_entry;
+    struct stat st;
+    unsigned int index;
+
+    if (!font_index) return FALSE;
+    font_index->file_pos = 0;
+    if (stat( file, &st ) == -1) return FALSE;
+
+    if ((entry = find_font_index_entry( file, &index )) &&
+        entry->mtime == st.st_mtime && entry->mtime_nsec == get_mtime_nsec( &st ) &&
+        entry->file_size == st.st_size && entry->ino == st.st_ino &&
+        entry->flags == (flags & ADDFONT_ALLOW_BITMAP) &&
+        add_faces_from_index( entry, file, &st, flags ))
+    {
+        TRACE( "loaded %s from font index\n", debugstr_a(file) );
+        /* a file may be found more than once, only index it the first time */
+        if (!font_index->used[index])
+        {
+            font_index->used[index] = TRUE;
+            font_index->reused++;
+            if (font_index_append( entry, entry->size )) font_index->new_count++;
+            else font_index->changed = TRUE;
+        }
+        *ret = entry->ret;
+        return TRUE;
+    }
+
+    font_index->changed = TRUE;
+    new_entry.size      = 0;
+    new_entry.flags     = flags & ADDFONT_ALLOW_BITMAP;
+    new_entry.mtime      = st.st_mtime;
+    new_entry.mtime_nsec = get_mtime_nsec( &st );
+    new_entry.ret        = 0;
+    new_entry.file_size  = st.st_size;
+    new_entry.ino        = st.st_ino;
+    new_entry.name_len   = strlen( file );
+    new_entry.reserved   = 0;
+    font_index->file_pos = font_index->len;
+    if (!font_index_append( &new_entry, sizeof(new_entry) ) ||
+        !font_index_append( file, new_entry.name_len + 1 ))
+    {
+        font_index->len = font_index->file_pos;
+        font_index->file_pos = 0;
+    }
+    return FALSE;
+}
+
+static void font_index_add_face( const Face *face, const WCHAR *family_name, const WCHAR *english_name )
+{
+    struct font_index_face rec;
+
+    if (!font_index || !font_index->file_pos) return;
+
+    rec.flags            = face->flags & ADDFONT_VERTICAL_FONT;
+    rec.face_index       = face->face_index;
+    rec.ntm_flags        = face->ntmFlags;
+    rec.font_version     = face->font_version;
+    rec.scalable         = face->scalable;
+    rec.fs               = face->fs;
+    rec.height           = face->size.height;
+    rec.width            = face->size.width;
+    rec.size             = face->size.size;
+    rec.x_ppem           = face->size.x_ppem;
+    rec.y_ppem           = face->size.y_ppem;
+    rec.internal_leading = face->size.internal_leading;
+
+    if (!font_index_append( &rec, sizeof(rec) ) ||
+        !font_index_append_string( family_name ) ||
+        !font_index_append_string( english_name ) ||
+        !font_index_append_string( face->StyleName ) ||
+        !font_index_append_string( face->FullName ))
+    {
+        /* drop the incomplete entry */
+        font_index->len = font_index->file_pos;
+        font_index->file_pos = 0;
+    }
+}
+
+static void font_index_end_file( INT ret )
+{
+    struct font_index_file *entry;
+
+    if (!font_index || !font_index->file_pos) return;
+
+    entry = (struct font_index_file *)(font_index->buffer + font_index->file_pos);
+    entry->size = font_index->len - font_index->file_pos;
+    entry->ret = ret;
+    font_index->new_count++;
+    font_index->file_pos = 0;
+}
+
+static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
+                          FT_Long face_index, DWORD flags )
+{
+    Face *face;
+    WCHAR *name, *english_name;
+
+    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
+    get_family_names( ft_face, &name, &english_name, flags & ADDFONT_VERTICAL_FONT );
+    if (file) font_index_add_face( face, name, english_name );
+    add_face( face, get_family_from_names( name, english_name ), flags );
+}
+
 static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_data_size,
                             FT_Long face_index, BOOL allow_bitmap )
 {
@@ -2260,18 +2739,25 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
     }
 #endif /* HAVE_CARBON_CARBON_H */
 
+    if (file && load_font_from_index( file, flags, &ret )) return ret;
+
     do {
         const DWORD FS_DBCS_MASK = FS_JISJAPAN|FS_CHINESESIMP|FS_WANSUNG|FS_CHINESETRAD|FS_JOHAB;
         FONTSIGNATURE fs;
 
         ft_face = new_ft_face( file, font_data_ptr, font_data_size, face_index, flags & ADDFONT_ALLOW_BITMAP );
-        if (!ft_face) return 0;
+        if (!ft_face)
+        {
+            ret = 0;
+            break;
+        }
 
         if(ft_face->family_name[0] == '.') /* Ignore fonts with names beginning with a dot */
         {
             TRACE("Ignoring %s since its family name begins with a dot\n", debugstr_a(file));
             pFT_Done_Face(ft_face);
-            return 0;
+            ret = 0;
+            break;
         }
 
         AddFaceToList(ft_face, file, font_data_ptr, font_data_size, face_index, flags);
@@ -2288,6 +2774,8 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
 	num_faces = ft_face->num_faces;
 	pFT_Done_Face(ft_face);
     } while(num_faces > ++face_index);
+
+    if (file) font_index_end_file( ret );
     return ret;
 }
 
@@ -4181,6 +4669,7 @@ static void init_font_list(void)
     char *unixname;
 
     delete_external_font_keys();
+    open_font_index();
 
     /* load the system bitmap fonts */
     load_system_fonts();
@@ -4306,6 +4795,8 @@ static void init_font_list(void)
         }
         RegCloseKey(hkey);
     }
+
+    close_font_index();
 }
 
 static BOOL move_to_front(const WCHAR *name)
@@ -8940,8 +9431,6 @@ static const struct gdi_dc_funcs freetype_funcs =
 
 #else /* HAVE_FREETYPE */
 
-struct font_fileinfo;
-
 /*************************************************************************/
 
 BOOL WineEngInit(void)
@@ -284,6 +284,18 @@ struct font_realization_info
     WORD  simulations; /* 0 bit - bold simulation, 1 bit - oblique simulation */
 };
 
+/* Undocumented structure filled in by GetFontFileInfo */
+struct font_fileinfo
+{
+    FILETIME writetime;
+    LARGE_INTEGER size;
+    WCHAR path[1];
+};
+
+extern BOOL WINAPI GetFontRealizationInfo( HDC hdc, struct font_realization_info *info ) DECLSPEC_HIDDEN;
+extern BOOL WINAPI GetFontFileInfo( DWORD instance_id, DWORD unknown, struct font_fileinfo *info,
+                                    DWORD size, DWORD *needed ) DECLSPEC_HIDDEN;
+
 extern INT WineEngAddFontResourceEx(LPCWSTR, DWORD, PVOID) DECLSPEC_HIDDEN;
 extern HANDLE WineEngAddFontMemResourceEx(PVOID, DWORD, PVOID, LPDWORD) DECLSPEC_HIDDEN;
 extern BOOL WineEngCreateScalableFontResource(DWORD, LPCWSTR, LPCWSTR, LPCWSTR) DECLSPEC_HIDDEN;
@@ -162,6 +162,56 @@ static BOOL add_rect( WINEREGION *reg, INT left, INT top, INT right, INT bottom
     return TRUE;
 }
 
+/* check if a rectangle can be appended to a region without disturbing its y-x banding */
+static inline BOOL can_append_rect( const WINEREGION *reg, const RECT *rect )
+{
+    const RECT *last;
+
+    if (!reg->numRects) return TRUE;
+    last = &reg->rects[reg->numRects - 1];
+    if (rect->top >= last->bottom) return TRUE;  /* new band below the region */
+    return (rect->top == last->top && rect->bottom == last->bottom && rect->left >= last->left);
+}
+
+/* append a rectangle to a region; the caller must have checked can_append_rect() */
+static BOOL append_rect( WINEREGION *reg, const RECT *rect )
+{
+    RECT *last = reg->numRects ? &reg->rects[reg->numRects - 1] : NULL;
+
+    if (last && rect->top == last->top && rect->left <= last->right)
+        last->right = max( last->right, rect->right );  /* merge with the last rect of the band */
+    else if (!add_rect( reg, rect->left, rect->top, rect->right, rect->bottom ))
+        return FALSE;
+
+    if (!last) reg->extents = *rect;
+    else
+    {
+        reg->extents.left = min( reg->extents.left, rect->left );
+        reg->extents.right = max( reg->extents.right, rect->right );
+        reg->extents.bottom = max( reg->extents.bottom, rect->bottom );
+    }
+    return TRUE;
+}
+
+/* find the start of the last two bands of a region */
+static void find_last_bands( const WINEREGION *reg, INT *prev_band, INT *cur_band )
+{
+    INT i = reg->numRects;
+
+    if (i)
+    {
+        INT top = reg->rects[i - 1].top;
+        while (i > 0 && reg->rects[i - 1].top == top) i--;
+    }
+    *cur_band = i;
+    if (i)
+    {
+        INT top = reg->rects[i - 1].top;
+        while (i > 0 && reg->rects[i - 1].top == top) i--;
+    }
+    *prev_band = i;
+}
+
 static inline void empty_region( WINEREGION *reg )
 {
     reg->numRects = 0;
@@ -370,6 +420,7 @@ static BOOL REGION_UnionRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_SubtractRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_XorRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_UnionRectWithRegion(const RECT *rect, WINEREGION *rgn);
+static INT REGION_Coalesce(WINEREGION *pReg, INT prevStart, INT curStart);
 
 /***********************************************************************
  *            get_region_type
@@ -952,6 +1003,7 @@ HRGN WINAPI ExtCreateRegion( const XFORM* lpXform, DWORD dwCount, const RGNDATA*
     HRGN hrgn = 0;
     WINEREGION *obj;
     const RECT *pCurRect, *pEndRect;
+    INT prev_band = 0, cur_band = 0;
 
     if (!rgndata)
     {
@@ -998,14 +1050,32 @@ HRGN WINAPI ExtCreateRegion( const XFORM* lpXform, DWORD dwCount, const RGNDATA*
 
     if (!(obj = alloc_region( rgndata->rdh.nCount ))) return 0;
 
+    /* rectangles that are already y-x banded (the usual case, e.g. data from
+     * GetRegionData) are appended directly and coalesced one band at a time,
+     * anything else falls back to a full union */
     pEndRect = (const RECT *)rgndata->Buffer + rgndata->rdh.nCount;
     for(pCurRect = (const RECT *)rgndata->Buffer; pCurRect < pEndRect; pCurRect++)
     {
         if (pCurRect->left < pCurRect->right && pCurRect->top < pCurRect->bottom)
         {
-            if (!REGION_UnionRectWithRegion( pCurRect, obj )) goto done;
+            if (can_append_rect( obj, pCurRect ))
+            {
+                if (obj->numRects && pCurRect->top != obj->rects[obj->numRects - 1].top)
+                {
+                    prev_band = REGION_Coalesce( obj, prev_band, cur_band );
+                    cur_band = obj->numRects;
+                }
+                if (!append_rect( obj, pCurRect )) goto done;
+            }
+            else
+            {
+                REGION_Coalesce( obj, prev_band, cur_band );
+                if (!REGION_UnionRectWithRegion( pCurRect, obj )) goto done;
+                find_last_bands( obj, &prev_band, &cur_band );
+            }
         }
     }
+    REGION_Coalesce( obj, prev_band, cur_band );
     hrgn = alloc_gdi_handle( obj, OBJ_REGION, &region_funcs );
 
 done:
@@ -1166,7 +1236,17 @@ BOOL add_rect_to_region( HRGN rgn, const RECT *rect )
     BOOL ret;
 
     if (!obj) return FALSE;
-    ret = REGION_UnionRectWithRegion( rect, obj );
+    if (!is_rect_empty( rect ) && can_append_rect( obj, rect ))
+    {
+        INT prev_band, cur_band;
+
+        if ((ret = append_rect( obj, rect )))
+        {
+            find_last_bands( obj, &prev_band, &cur_band );
+            REGION_Coalesce( obj, prev_band, cur_band );
+        }
+    }
+    else ret = REGION_UnionRectWithRegion( rect, obj );
     GDI_ReleaseObj( rgn );
     return ret;
 }
@@ -3977,6 +3977,78 @@ static void test_clipping(void)
     DeleteDC( hdcSrc );
 }
 
+static void test_large_blits(void)
+{
+    static const int width = 512, height = 512;
+    BITMAPINFO bmi;
+    HBITMAP bmp_src, bmp_dst;
+    HDC hdc_src, hdc_dst;
+    BLENDFUNCTION blend;
+    DWORD *src_bits, *dst_bits, src, dst, expect, alpha;
+    int x, y, i, errors;
+    BOOL ret;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth       = width;
+    bmi.bmiHeader.biHeight      = -height;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC( NULL );
+    hdc_dst = CreateCompatibleDC( NULL );
+    bmp_src = CreateDIBSection( hdc_src, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+
+    /* premultiplied source with a different value on every row */
+    for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+        {
+            alpha = (x + y) & 0xff;
+            src_bits[y * width + x] = alpha << 24 | (alpha * (y & 0xff) / 255) << 16 | (alpha / 2) << 8 | alpha / 3;
+        }
+
+    ret = PatBlt( hdc_dst, 0, 0, width, height, WHITENESS );
+    ok( ret, "PatBlt failed\n" );
+    for (i = errors = 0; i < width * height; i++) if (dst_bits[i] != 0xffffffff) errors++;
+    ok( !errors, "got %d wrong pixels after PatBlt\n", errors );
+
+    if (pGdiAlphaBlend)
+    {
+        blend.BlendOp             = AC_SRC_OVER;
+        blend.BlendFlags          = 0;
+        blend.SourceConstantAlpha = 255;
+        blend.AlphaFormat         = AC_SRC_ALPHA;
+        memset( dst_bits, 0x40, width * height * 4 );
+        ret = pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend );
+        ok( ret, "GdiAlphaBlend failed\n" );
+        for (i = errors = 0; i < width * height; i++)
+        {
+            src = src_bits[i];
+            dst = (0x40 * (255 - (src >> 24)) + 127) / 255;
+            expect = src + (dst | dst << 8 | dst << 16 | dst << 24);
+            if (dst_bits[i] != expect) errors++;
+        }
+        ok( !errors, "got %d wrong pixels after GdiAlphaBlend\n", errors );
+    }
+    else win_skip( "GdiAlphaBlend() is not implemented\n" );
+
+    /* stretch the top half of the source over the whole destination */
+    ret = StretchBlt( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height / 2, SRCCOPY );
+    ok( ret, "StretchBlt failed\n" );
+    for (y = errors = 0; y < height; y++)
+        if (memcmp( dst_bits + y * width, src_bits + y / 2 * width, width * 4 )) errors++;
+    ok( !errors, "got %d wrong rows after StretchBlt\n", errors );
+
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
 static void test_32bit_ddb(void)
 {
     char buffer[sizeof(BITMAPINFOHEADER) + sizeof(DWORD)];
@@ -5956,6 +6028,7 @@ START_TEST(bitmap)
     test_StretchDIBits();
     test_GdiAlphaBlend();
     test_GdiGradientFill();
+    test_large_blits();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
     test_get16dibits();
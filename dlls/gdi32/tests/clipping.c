@@ -291,6 +291,65 @@ static void test_ExtCreateRegion(void)
 
 }
 
+static void test_ExtCreateRegion_bands(void)
+{
+    RGNDATA *data;
+    RECT *rects, rc;
+    HRGN hrgn, expect, tmp;
+    DWORD count = 0, size;
+    int x, y, ret;
+
+    size = sizeof(RGNDATAHEADER) + (32 * 16 + 1) * sizeof(RECT);
+    data = HeapAlloc(GetProcessHeap(), 0, size);
+    rects = (RECT *)data->Buffer;
+    expect = CreateRectRgn(0, 0, 0, 0);
+
+    /* already y-x banded rectangles, with touching ones that have to be merged */
+    for (y = 0; y < 32; y++)
+    {
+        for (x = 0; x < 16; x++)
+        {
+            SetRect(&rects[count++], x * 10 + (y & 1) * 5, y * 4, x * 10 + (y & 1) * 5 + (x % 3 ? 5 : 10), y * 4 + 4);
+            tmp = CreateRectRgnIndirect(&rects[count - 1]);
+            CombineRgn(expect, expect, tmp, RGN_OR);
+            DeleteObject(tmp);
+        }
+    }
+    /* followed by one that isn't */
+    SetRect(&rects[count++], 0, 0, 200, 2);
+    tmp = CreateRectRgnIndirect(&rects[count - 1]);
+    CombineRgn(expect, expect, tmp, RGN_OR);
+    DeleteObject(tmp);
+
+    data->rdh.dwSize = sizeof(data->rdh);
+    data->rdh.iType = RDH_RECTANGLES;
+    data->rdh.nCount = count;
+    data->rdh.nRgnSize = 0;
+    SetRectEmpty(&data->rdh.rcBound);
+
+    hrgn = ExtCreateRegion(NULL, size, data);
+    ok(hrgn != 0, "ExtCreateRegion error %u\n", GetLastError());
+    ok(EqualRgn(hrgn, expect), "regions don't match\n");
+
+    ret = GetRgnBox(hrgn, &rc);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    ok(rc.left == 0 && rc.top == 0 && rc.right == 200 && rc.bottom == 128, "got %s\n", wine_dbgstr_rect(&rc));
+
+    ok(PtInRegion(hrgn, 150, 1), "point should be in region\n");
+    ok(PtInRegion(hrgn, 5, 124), "point should be in region\n");
+    ok(!PtInRegion(hrgn, 4, 124), "point shouldn't be in region\n");
+    ok(!PtInRegion(hrgn, 22, 124), "point shouldn't be in region\n");
+    ok(!PtInRegion(hrgn, 0, 128), "point shouldn't be in region\n");
+    SetRect(&rc, 20, 124, 25, 128);
+    ok(!RectInRegion(hrgn, &rc), "rect shouldn't be in region\n");
+    SetRect(&rc, 20, 124, 26, 128);
+    ok(RectInRegion(hrgn, &rc), "rect should be in region\n");
+
+    DeleteObject(hrgn);
+    DeleteObject(expect);
+    HeapFree(GetProcessHeap(), 0, data);
+}
+
 static void test_GetClipRgn(void)
 {
     HDC hdc;
@@ -538,6 +597,7 @@ START_TEST(clipping)
 {
     test_GetRandomRgn();
     test_ExtCreateRegion();
+    test_ExtCreateRegion_bands();
     test_GetClipRgn();
     test_memory_dc_clipping();
     test_window_dc_clipping();
@@ -6047,6 +6047,65 @@ static void check_vertical_metrics(const char *face)
     ReleaseDC(NULL, hdc);
 }
 
+static void draw_vertical_text(HDC hdc, const char *name, const DWORD *bits, DWORD *copy, DWORD size)
+{
+    static const WCHAR str[] = { 0x2025 };
+    LOGFONTA lf;
+    HFONT hfont, hfont_prev;
+    BOOL ret;
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = -18;
+    lf.lfCharSet = DEFAULT_CHARSET;
+    lf.lfOutPrecision = OUT_TT_ONLY_PRECIS;
+    lf.lfQuality = NONANTIALIASED_QUALITY;
+    strcpy(lf.lfFaceName, name);
+
+    hfont = CreateFontIndirectA(&lf);
+    ok(hfont != NULL, "CreateFontIndirectA failed\n");
+    hfont_prev = SelectObject(hdc, hfont);
+
+    PatBlt(hdc, 0, 0, 64, 64, WHITENESS);
+    ret = ExtTextOutW(hdc, 16, 16, 0, NULL, str, 1, NULL);
+    ok(ret, "ExtTextOutW failed\n");
+    GdiFlush();
+    memcpy(copy, bits, size);
+
+    DeleteObject(SelectObject(hdc, hfont_prev));
+}
+
+static void check_vertical_text(void)
+{
+    BITMAPINFO bmi;
+    HBITMAP bmp, bmp_prev;
+    DWORD *bits, horz[64 * 64], vert[64 * 64];
+    HDC hdc;
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 64;
+    bmi.bmiHeader.biHeight = -64;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC(0);
+    bmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    ok(bmp != NULL, "CreateDIBSection failed\n");
+    bmp_prev = SelectObject(hdc, bmp);
+
+    /* the same file and face must not share glyphs between vertical and horizontal writing */
+    draw_vertical_text(hdc, "WineTestVertical", bits, horz, sizeof(horz));
+    draw_vertical_text(hdc, "@WineTestVertical", bits, vert, sizeof(vert));
+    ok(memcmp(horz, vert, sizeof(horz)), "vertical text drawn like horizontal text\n");
+    draw_vertical_text(hdc, "WineTestVertical", bits, vert, sizeof(vert));
+    ok(!memcmp(horz, vert, sizeof(horz)), "horizontal text drawn differently\n");
+
+    SelectObject(hdc, bmp_prev);
+    DeleteObject(bmp);
+    DeleteDC(hdc);
+}
+
 static void test_vertical_font(void)
 {
     char ttf_name[MAX_PATH];
@@ -6091,6 +6150,8 @@ static void test_vertical_font(void)
 
     ok(hgi != vgi, "same glyph h:%u v:%u\n", hgi, vgi);
 
+    check_vertical_text();
+
     for (i = 0; i < ARRAY_SIZE(face_list); i++) {
         const char* face = face_list[i];
         if (!is_truetype_font_installed(face)) {
@@ -27,6 +27,12 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_IOCTL_H
+# include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 
 #include "winerror.h"
 #include "ntstatus.h"
@@ -43,6 +49,10 @@ WINE_DEFAULT_DEBUG_CHANNEL(file);
 
 #define MAX_PATHNAME_LEN        1024
 
+#if defined(__linux__) && !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 static int path_safe_mode = -1;  /* path mode set by SetSearchPathMode */
 
 /* check if a file name is for an executable file (.exe or .com) */
@@ -1121,6 +1131,149 @@ static BOOL is_same_file(HANDLE h1, HANDLE h2)
     return ret;
 }
 
+/* call the progress routine of CopyFileEx; returns FALSE if the copy has to be aborted */
+static BOOL copy_progress( LPPROGRESS_ROUTINE *progress, void *param, BOOL *cancel_ptr,
+                           LARGE_INTEGER total, LARGE_INTEGER done, DWORD reason,
+                           HANDLE h1, HANDLE h2, BOOL *delete_dest )
+{
+    if (cancel_ptr && *cancel_ptr)
+    {
+        *delete_dest = TRUE;
+        SetLastError( ERROR_REQUEST_ABORTED );
+        return FALSE;
+    }
+    if (!*progress) return TRUE;
+
+    switch ((*progress)( total, done, total, done, 1, reason, h1, h2, param ))
+    {
+    case PROGRESS_QUIET:
+        *progress = NULL;
+        return TRUE;
+    case PROGRESS_CANCEL:
+        *delete_dest = TRUE;
+        /* fall through */
+    case PROGRESS_STOP:
+        SetLastError( ERROR_REQUEST_ABORTED );
+        return FALSE;
+    default:
+        return TRUE;
+    }
+}
+
+#if defined(__linux__) && defined(__NR_copy_file_range)
+/* copy a chunk of data within the kernel; returns -1 if not supported for these files */
+static LONGLONG copy_file_range_chunk( int fd1, int fd2, LONGLONG offset, size_t size )
+{
+    loff_t in = offset, out = offset;
+    LONGLONG ret;
+
+    do ret = syscall( __NR_copy_file_range, fd1, &in, fd2, &out, size, 0 );
+    while (ret == -1 && errno == EINTR);
+    return ret;
+}
+#endif
+
+/***********************************************************************
+ *           copy_file_data
+ *
+ * Copy the contents of a file for CopyFileEx. Try to share the data blocks
+ * with a reflink clone first, then to copy them within the kernel, and fall
+ * back to a read/write loop for the rest. The progress routine is called
+ * after each chunk of buffer_size bytes in all cases.
+ */
+static BOOL copy_file_data( HANDLE h1, HANDLE h2, const BY_HANDLE_FILE_INFORMATION *info,
+                            LPPROGRESS_ROUTINE progress, void *param, BOOL *cancel_ptr, BOOL *delete_dest )
+{
+    static const DWORD buffer_size = 65536;
+    LARGE_INTEGER total, copied;
+    DWORD count;
+    char *buffer;
+    int fd1, fd2;
+    BOOL ret = FALSE;
+
+    total.u.LowPart  = info->nFileSizeLow;
+    total.u.HighPart = info->nFileSizeHigh;
+    copied.QuadPart = 0;
+
+    if (!copy_progress( &progress, param, cancel_ptr, total, copied, CALLBACK_STREAM_SWITCH,
+                        h1, h2, delete_dest ))
+        return FALSE;
+
+    if (!wine_server_handle_to_fd( h1, FILE_READ_DATA, &fd1, NULL ))
+    {
+        if (!wine_server_handle_to_fd( h2, FILE_WRITE_DATA, &fd2, NULL ))
+        {
+            int finished = 0;
+#ifdef FICLONE
+            struct stat st;
+
+            if (!ioctl( fd2, FICLONE, fd1 ) && !fstat( fd1, &st ))
+            {
+                TRACE( "cloned %s bytes\n", wine_dbgstr_longlong( st.st_size ));
+                copied.QuadPart = st.st_size;
+                finished = (!copied.QuadPart || copy_progress( &progress, param, cancel_ptr, total, copied,
+                                                               CALLBACK_CHUNK_FINISHED, h1, h2,
+                                                               delete_dest )) ? 1 : -1;
+            }
+#endif
+#if defined(__linux__) && defined(__NR_copy_file_range)
+            while (!finished)
+            {
+                LONGLONG res = copy_file_range_chunk( fd1, fd2, copied.QuadPart,
+                                                      progress ? buffer_size : 0x40000000 );
+                if (res == -1) break;  /* not supported, use the fallback */
+                if (!res)
+                {
+                    /* some special files report no data, read them the normal way */
+                    if (!copied.QuadPart && total.QuadPart) break;
+                    finished = 1;
+                }
+                else
+                {
+                    copied.QuadPart += res;
+                    if (!copy_progress( &progress, param, cancel_ptr, total, copied,
+                                        CALLBACK_CHUNK_FINISHED, h1, h2, delete_dest ))
+                        finished = -1;
+                }
+            }
+#endif
+            wine_server_release_fd( h2, fd2 );
+            wine_server_release_fd( h1, fd1 );
+            if (finished) return finished > 0;
+        }
+        else wine_server_release_fd( h1, fd1 );
+    }
+
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
+    {
+        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+        return FALSE;
+    }
+    /* continue where the in-kernel copy stopped */
+    SetFilePointerEx( h1, copied, NULL, FILE_BEGIN );
+    SetFilePointerEx( h2, copied, NULL, FILE_BEGIN );
+
+    while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
+    {
+        char *p = buffer;
+        while (count != 0)
+        {
+            DWORD res;
+            if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto failed;
+            p += res;
+            count -= res;
+            copied.QuadPart += res;
+        }
+        if (!copy_progress( &progress, param, cancel_ptr, total, copied, CALLBACK_CHUNK_FINISHED,
+                            h1, h2, delete_dest ))
+            goto failed;
+    }
+    ret = TRUE;
+failed:
+    HeapFree( GetProcessHeap(), 0, buffer );
+    return ret;
+}
+
 /**************************************************************************
  *           CopyFileW   (KERNEL32.@)
  */
@@ -1156,23 +1309,16 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
                         LPPROGRESS_ROUTINE progress, LPVOID param,
                         LPBOOL cancel_ptr, DWORD flags)
 {
-    static const int buffer_size = 65536;
     HANDLE h1, h2;
     BY_HANDLE_FILE_INFORMATION info;
-    DWORD count;
-    BOOL ret = FALSE;
-    char *buffer;
+    BOOL ret, delete_dest = FALSE;
+    DWORD err;
 
     if (!source || !dest)
     {
         SetLastError(ERROR_INVALID_PARAMETER);
         return FALSE;
     }
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
-    {
-        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
-        return FALSE;
-    }
 
     TRACE("%s -> %s, %x\n", debugstr_w(source), debugstr_w(dest), flags);
 
@@ -1181,14 +1327,12 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
                      NULL, OPEN_EXISTING, 0, 0)) == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open source %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         return FALSE;
     }
 
     if (!GetFileInformationByHandle( h1, &info ))
     {
         WARN("GetFileInformationByHandle returned error for %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
@@ -1205,41 +1349,41 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
         }
         if (same_file)
         {
-            HeapFree( GetProcessHeap(), 0, buffer );
             CloseHandle( h1 );
             SetLastError( ERROR_SHARING_VIOLATION );
             return FALSE;
         }
     }
 
-    if ((h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
-                             (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
-                             info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE)
+    /* the DELETE access is only needed to remove the file if the copy gets cancelled */
+    if ((h2 = CreateFileW( dest, GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                           info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE &&
+        (h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                           info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open dest %s\n", debugstr_w(dest));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
 
-    while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
+    ret = copy_file_data( h1, h2, &info, progress, param, cancel_ptr, &delete_dest );
+    err = GetLastError();
+
+    if (delete_dest)
     {
-        char *p = buffer;
-        while (count != 0)
-        {
-            DWORD res;
-            if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto done;
-            p += res;
-            count -= res;
-        }
+        FILE_DISPOSITION_INFORMATION disp;
+        IO_STATUS_BLOCK io;
+
+        disp.DoDeleteFile = TRUE;
+        NtSetInformationFile( h2, &io, &disp, sizeof(disp), FileDispositionInformation );
     }
-    ret =  TRUE;
-done:
     /* Maintain the timestamp of source file to destination file */
-    SetFileTime(h2, NULL, NULL, &info.ftLastWriteTime);
-    HeapFree( GetProcessHeap(), 0, buffer );
+    else SetFileTime(h2, NULL, NULL, &info.ftLastWriteTime);
     CloseHandle( h1 );
     CloseHandle( h2 );
+    if (!ret) SetLastError( err );
     return ret;
 }
 
@@ -2380,6 +2380,47 @@ BOOL WINAPI GetQueuedCompletionStatus( HANDLE CompletionPort, LPDWORD lpNumberOf
 }
 
 
+/******************************************************************************
+ *		GetQueuedCompletionStatusEx (KERNEL32.@)
+ */
+BOOL WINAPI GetQueuedCompletionStatusEx( HANDLE port, OVERLAPPED_ENTRY *entries, ULONG count,
+                                         ULONG *written, DWORD timeout, BOOL alertable )
+{
+    FILE_IO_COMPLETION_INFORMATION info[64], *ptr = info;
+    LARGE_INTEGER time;
+    NTSTATUS status;
+    ULONG i;
+
+    TRACE("(%p,%p,%u,%p,%u,%d)\n", port, entries, count, written, timeout, alertable);
+
+    if (count > ARRAY_SIZE(info) &&
+        !(ptr = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*ptr) )))
+    {
+        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+        return FALSE;
+    }
+
+    status = NtRemoveIoCompletionEx( port, ptr, count, written, get_nt_timeout( &time, timeout ), alertable );
+    if (status == STATUS_SUCCESS)
+    {
+        for (i = 0; i < *written; i++)
+        {
+            entries[i].lpCompletionKey            = ptr[i].CompletionKey;
+            entries[i].lpOverlapped               = (LPOVERLAPPED)ptr[i].CompletionValue;
+            entries[i].Internal                   = ptr[i].IoStatusBlock.u.Status;
+            entries[i].dwNumberOfBytesTransferred = ptr[i].IoStatusBlock.Information;
+        }
+    }
+    if (ptr != info) HeapFree( GetProcessHeap(), 0, ptr );
+    if (status == STATUS_SUCCESS) return TRUE;
+
+    if (status == STATUS_TIMEOUT) SetLastError( WAIT_TIMEOUT );
+    else if (status == STATUS_USER_APC) SetLastError( WAIT_IO_COMPLETION );
+    else SetLastError( RtlNtStatusToDosError(status) );
+    return FALSE;
+}
+
+
 /******************************************************************************
  *		PostQueuedCompletionStatus (KERNEL32.@)
  */
@@ -1148,23 +1148,17 @@ static void test_CopyFileEx(void)
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
     ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
 
     hfile = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                         NULL, OPEN_EXISTING, 0, 0);
-    todo_wine
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
-    todo_wine
     ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
 
     ret = DeleteFileA(source);
@@ -1173,6 +1167,101 @@ static void test_CopyFileEx(void)
     ok(!ret, "DeleteFileA unexpectedly succeeded\n");
 }
 
+struct copy_progress_info
+{
+    unsigned int  chunks;
+    LARGE_INTEGER transferred;
+    DWORD         ret;
+};
+
+static DWORD WINAPI copy_chunks_cb(LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                   LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                   DWORD stream, DWORD reason, HANDLE source, HANDLE dest, LPVOID userdata)
+{
+    struct copy_progress_info *info = userdata;
+
+    ok(stream == 1, "got stream %u\n", stream);
+    ok(total_size.QuadPart == stream_size.QuadPart, "got sizes %s / %s\n",
+       wine_dbgstr_longlong(total_size.QuadPart), wine_dbgstr_longlong(stream_size.QuadPart));
+    ok(total_transferred.QuadPart >= info->transferred.QuadPart, "got transferred %s after %s\n",
+       wine_dbgstr_longlong(total_transferred.QuadPart), wine_dbgstr_longlong(info->transferred.QuadPart));
+    if (reason == CALLBACK_STREAM_SWITCH)
+    {
+        ok(!info->chunks, "got stream switch after %u chunks\n", info->chunks);
+        ok(!total_transferred.QuadPart, "got transferred %s\n", wine_dbgstr_longlong(total_transferred.QuadPart));
+    }
+    else
+    {
+        ok(reason == CALLBACK_CHUNK_FINISHED, "got reason %u\n", reason);
+        info->chunks++;
+    }
+    info->transferred = total_transferred;
+    return info->ret;
+}
+
+static void test_CopyFileEx_progress(void)
+{
+    char temp_path[MAX_PATH], source[MAX_PATH], dest[MAX_PATH];
+    static const char prefix[] = "pfx";
+    struct copy_progress_info info;
+    char *buffer, *buffer2;
+    const DWORD size = 1024 * 1024 + 1234;
+    BOOL cancel = FALSE;
+    HANDLE hfile;
+    DWORD i, ret;
+    BOOL retok;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, prefix, 0, source);
+    GetTempFileNameA(temp_path, prefix, 0, dest);
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, size);
+    buffer2 = HeapAlloc(GetProcessHeap(), 0, size);
+    for (i = 0; i < size; i++) buffer[i] = i * 7;
+    hfile = CreateFileA(source, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open source file, error %d\n", GetLastError());
+    retok = WriteFile(hfile, buffer, size, &ret, NULL);
+    ok(retok && ret == size, "WriteFile failed, error %d\n", GetLastError());
+    CloseHandle(hfile);
+
+    memset(&info, 0, sizeof(info));
+    info.ret = PROGRESS_CONTINUE;
+    retok = CopyFileExA(source, dest, copy_chunks_cb, &info, &cancel, 0);
+    ok(retok, "CopyFileExA failed, error %d\n", GetLastError());
+    ok(info.chunks >= 1, "got %u chunks\n", info.chunks);
+    ok(info.transferred.QuadPart == size, "got transferred %s\n", wine_dbgstr_longlong(info.transferred.QuadPart));
+
+    hfile = CreateFileA(dest, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
+    retok = ReadFile(hfile, buffer2, size, &ret, NULL);
+    ok(retok && ret == size, "ReadFile failed, got %u bytes, error %d\n", ret, GetLastError());
+    ok(!memcmp(buffer, buffer2, size), "wrong file contents\n");
+    CloseHandle(hfile);
+
+    /* PROGRESS_QUIET stops the callbacks but not the copy */
+    memset(&info, 0, sizeof(info));
+    info.ret = PROGRESS_QUIET;
+    retok = CopyFileExA(source, dest, copy_chunks_cb, &info, NULL, 0);
+    ok(retok, "CopyFileExA failed, error %d\n", GetLastError());
+    ok(!info.chunks, "got %u chunks\n", info.chunks);
+    ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
+
+    /* a set cancel flag aborts the copy and deletes the destination */
+    cancel = TRUE;
+    memset(&info, 0, sizeof(info));
+    info.ret = PROGRESS_CONTINUE;
+    SetLastError(0xdeadbeef);
+    retok = CopyFileExA(source, dest, copy_chunks_cb, &info, &cancel, 0);
+    ok(!retok, "CopyFileExA unexpectedly succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
+    ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+    HeapFree(GetProcessHeap(), 0, buffer2);
+    DeleteFileA(source);
+    DeleteFileA(dest);
+}
+
 /*
  *   Debugging routine to dump a buffer in a hexdump-like fashion.
  */
@@ -4981,6 +5070,7 @@ START_TEST(file)
     test_CopyFileW();
     test_CopyFile2();
     test_CopyFileEx();
+    test_CopyFileEx_progress();
     test_CreateFile();
     test_CreateFileA();
     test_CreateFileW();
@@ -892,6 +892,95 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static DWORD WINAPI lfh_thread( void *arg )
+{
+    HANDLE heap = arg;
+    BYTE *ptrs[64];
+    SIZE_T size;
+    unsigned int i, j;
+
+    for (i = 0; i < 100; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+        {
+            size = 1 + (j * 17) % 1000;
+            ptrs[j] = HeapAlloc( heap, (j & 1) ? HEAP_ZERO_MEMORY : 0, size );
+            ok( ptrs[j] != NULL, "HeapAlloc %lu failed\n", size );
+            if ((j & 1) && ptrs[j]) ok( !ptrs[j][size - 1], "memory not zeroed\n" );
+            memset( ptrs[j], j, size );
+        }
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+        {
+            size = 1 + (j * 17) % 1000;
+            ok( HeapSize( heap, 0, ptrs[j] ) == size, "wrong size %lu/%lu\n",
+                HeapSize( heap, 0, ptrs[j] ), size );
+            ok( ptrs[j][0] == (BYTE)j && ptrs[j][size - 1] == (BYTE)j, "block %u overwritten\n", j );
+            ok( HeapFree( heap, 0, ptrs[j] ), "HeapFree failed\n" );
+        }
+    }
+    return 0;
+}
+
+static void test_low_fragmentation_heap(void)
+{
+    HANDLE heap, threads[4];
+    ULONG info;
+    BYTE *ptr, *ptr2;
+    unsigned int i;
+    BOOL ret;
+
+    if (!pHeapQueryInformation)
+    {
+        win_skip("HeapQueryInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded on a HEAP_NO_SERIALIZE heap\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        /* debug heaps can't use the low-fragmentation heap */
+        skip( "low-fragmentation heap not available\n" );
+        HeapDestroy( heap );
+        return;
+    }
+
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    ptr = HeapAlloc( heap, 0, 24 );
+    ok( ptr != NULL, "HeapAlloc failed\n" );
+    ok( HeapSize( heap, 0, ptr ) == 24, "wrong size %lu\n", HeapSize( heap, 0, ptr ) );
+    ok( HeapValidate( heap, 0, ptr ), "HeapValidate failed\n" );
+    ptr2 = HeapReAlloc( heap, 0, ptr, 3000 );
+    ok( ptr2 != NULL, "HeapReAlloc failed\n" );
+    ok( HeapSize( heap, 0, ptr2 ) == 3000, "wrong size %lu\n", HeapSize( heap, 0, ptr2 ) );
+    ok( HeapFree( heap, 0, ptr2 ), "HeapFree failed\n" );
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread( NULL, 0, lfh_thread, heap, 0, NULL );
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        ok( !WaitForSingleObject( threads[i], 60000 ), "thread %u didn't finish\n", i );
+        CloseHandle( threads[i] );
+    }
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1334,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_low_fragmentation_heap();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
@@ -573,6 +573,66 @@ static void test_event(void)
     CloseHandle( handle );
 }
 
+static DWORD WINAPI pulse_event_thread(void *arg)
+{
+    return WaitForSingleObject(arg, 5000);
+}
+
+static void test_pulse_event(void)
+{
+    HANDLE event, threads[2];
+    DWORD ret, code, released;
+    int i;
+
+    /* a pulse releases all the waiters of a manual-reset event */
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    for (i = 0; i < 2; i++) threads[i] = CreateThread(NULL, 0, pulse_event_thread, event, 0, NULL);
+    Sleep(200);  /* give the threads time to start waiting */
+
+    ret = PulseEvent(event);
+    ok(ret, "PulseEvent failed err %u\n", GetLastError());
+    ret = WaitForMultipleObjects(2, threads, TRUE, 2000);
+    ok(ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", ret);
+    for (i = 0; i < 2; i++)
+    {
+        GetExitCodeThread(threads[i], &code);
+        ok(code == WAIT_OBJECT_0, "thread %d got %u\n", i, code);
+        CloseHandle(threads[i]);
+    }
+    ret = WaitForSingleObject(event, 0);
+    ok(ret == WAIT_TIMEOUT, "event is signaled after pulse, ret %u\n", ret);
+    CloseHandle(event);
+
+    /* and a single one of an auto-reset event */
+    event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    for (i = 0; i < 2; i++) threads[i] = CreateThread(NULL, 0, pulse_event_thread, event, 0, NULL);
+    Sleep(200);
+
+    ret = PulseEvent(event);
+    ok(ret, "PulseEvent failed err %u\n", GetLastError());
+    ret = WaitForMultipleObjects(2, threads, FALSE, 2000);
+    ok(ret == WAIT_OBJECT_0 || ret == WAIT_OBJECT_0 + 1, "WaitForMultipleObjects returned %u\n", ret);
+    released = ret - WAIT_OBJECT_0;
+    ret = WaitForSingleObject(threads[!released], 200);
+    ok(ret == WAIT_TIMEOUT, "both threads were released, ret %u\n", ret);
+    ret = WaitForSingleObject(event, 0);
+    ok(ret == WAIT_TIMEOUT, "event is signaled after pulse, ret %u\n", ret);
+
+    ret = SetEvent(event);
+    ok(ret, "SetEvent failed err %u\n", GetLastError());
+    ret = WaitForMultipleObjects(2, threads, TRUE, 2000);
+    ok(ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", ret);
+    for (i = 0; i < 2; i++)
+    {
+        GetExitCodeThread(threads[i], &code);
+        ok(code == WAIT_OBJECT_0, "thread %d got %u\n", i, code);
+        CloseHandle(threads[i]);
+    }
+    ret = WaitForSingleObject(event, 0);
+    ok(ret == WAIT_TIMEOUT, "event is signaled, ret %u\n", ret);
+    CloseHandle(event);
+}
+
 static void test_semaphore(void)
 {
     HANDLE handle, handle2;
@@ -2681,6 +2741,7 @@ START_TEST(sync)
     test_mutex();
     test_slist();
     test_event();
+    test_pulse_event();
     test_semaphore();
     test_waitable_timer();
     test_iocp_callback();
@@ -490,6 +490,57 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+static void test_VirtualAlloc_fragmented(void)
+{
+    static const unsigned int count = 2000;
+    MEMORY_BASIC_INFORMATION info;
+    void **addrs, *big[100];
+    unsigned int i;
+    SIZE_T ret;
+
+    addrs = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*addrs) );
+
+    for (i = 0; i < count; i++)
+    {
+        addrs[i] = VirtualAlloc( NULL, si.dwAllocationGranularity, MEM_RESERVE, PAGE_NOACCESS );
+        ok( addrs[i] != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+        if (!addrs[i]) break;
+    }
+    if (i < count)
+    {
+        while (i--) VirtualFree( addrs[i], 0, MEM_RELEASE );
+        HeapFree( GetProcessHeap(), 0, addrs );
+        return;
+    }
+
+    /* free every other region to leave holes that are too small for larger allocations */
+    for (i = 0; i < count; i += 2)
+        ok( VirtualFree( addrs[i], 0, MEM_RELEASE ), "%u: VirtualFree failed %u\n", i, GetLastError() );
+
+    for (i = 0; i < sizeof(big) / sizeof(big[0]); i++)
+    {
+        big[i] = VirtualAlloc( NULL, 4 * si.dwAllocationGranularity, MEM_RESERVE, PAGE_NOACCESS );
+        ok( big[i] != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+        if (!big[i]) continue;
+        ok( !((ULONG_PTR)big[i] & (si.dwAllocationGranularity - 1)), "%u: wrong alignment %p\n", i, big[i] );
+        ret = VirtualQuery( big[i], &info, sizeof(info) );
+        ok( ret == sizeof(info), "%u: VirtualQuery failed\n", i );
+        ok( info.AllocationBase == big[i], "%u: wrong allocation base %p / %p\n", i, info.AllocationBase, big[i] );
+        ok( info.RegionSize == 4 * si.dwAllocationGranularity, "%u: wrong size %lx\n", i, info.RegionSize );
+    }
+
+    /* the holes are still usable for allocations that fit */
+    for (i = 0; i < count; i += 2)
+    {
+        addrs[i] = VirtualAlloc( NULL, si.dwAllocationGranularity, MEM_RESERVE, PAGE_NOACCESS );
+        ok( addrs[i] != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+    }
+
+    for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) if (big[i]) VirtualFree( big[i], 0, MEM_RELEASE );
+    for (i = 0; i < count; i++) if (addrs[i]) VirtualFree( addrs[i], 0, MEM_RELEASE );
+    HeapFree( GetProcessHeap(), 0, addrs );
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -4404,6 +4455,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_VirtualAlloc_fragmented();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
     test_NtAreMappedFilesTheSame();
@@ -30,6 +30,7 @@
 #endif
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
@@ -182,6 +183,13 @@ struct dir_data_names
     const char  *unix_name;          /* Unix file name in host encoding */
 };
 
+struct dir_data_stat
+{
+    struct stat             st;      /* Unix file information */
+    ULONG                   attr;    /* file attributes */
+    int                     ret;     /* result of get_file_info */
+};
+
 struct dir_data
 {
     unsigned int            size;    /* size of the names array */
@@ -190,11 +198,21 @@ struct dir_data
     struct file_identity    id;      /* directory file identity */
     struct dir_data_names  *names;   /* directory file names */
     struct dir_data_buffer *buffer;  /* head of data buffers list */
+    unsigned int            stat_pos;    /* index of the first prefetched entry in the names array */
+    unsigned int            stat_count;  /* count of used entries in the stats array */
+    unsigned int            stat_size;   /* size of the stats array */
+    struct dir_data_stat   *stats;       /* prefetched file information */
 };
 
 static const unsigned int dir_data_buffer_initial_size = 4096;
 static const unsigned int dir_data_cache_initial_size  = 256;
 static const unsigned int dir_data_names_initial_size  = 64;
+static const unsigned int dir_data_stat_max_batch      = 1024;
+static const unsigned int dir_data_stat_thread_batch   = 128;  /* min entries per prefetch thread */
+static const unsigned int dir_data_stat_probe          = 16;   /* entries timed before going parallel */
+static const ULONGLONG    dir_data_stat_slow           = 200;  /* time per entry (in 100ns) worth overlapping */
+
+#define MAX_DIR_DATA_STAT_THREADS 4
 
 static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
@@ -380,6 +398,7 @@ static void free_dir_data( struct dir_data *data )
         RtlFreeHeap( GetProcessHeap(), 0, buffer );
     }
     RtlFreeHeap( GetProcessHeap(), 0, data->names );
+    RtlFreeHeap( GetProcessHeap(), 0, data->stats );
     RtlFreeHeap( GetProcessHeap(), 0, data );
 }
 
@@ -1485,6 +1504,159 @@ static BOOL append_entry( struct dir_data *data, const char *long_name,
 }
 
 
+struct dir_data_stat_batch
+{
+    struct dir_data *data;
+    unsigned int     count;          /* number of entries to retrieve */
+    LONG             next;           /* next entry to retrieve */
+};
+
+/* helper threads overlapping the stat() calls of slow directories; they are started
+ * the first time they are needed and then wait for the next batch */
+static pthread_mutex_t stat_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stat_pool_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t stat_pool_done_cond = PTHREAD_COND_INITIALIZER;
+static struct dir_data_stat_batch *stat_pool_batch;  /* batch being processed */
+static unsigned int stat_pool_gen;      /* incremented for every new batch */
+static unsigned int stat_pool_threads;  /* number of helper threads */
+static unsigned int stat_pool_busy;     /* helper threads still working on the batch */
+
+/* retrieve the file information of the batch entries until none are left */
+static void stat_dir_data_batch( struct dir_data_stat_batch *batch )
+{
+    struct dir_data *data = batch->data;
+    struct dir_data_stat *stat;
+    unsigned int i, end;
+
+    /* grab a few entries at a time to avoid contention on the counter */
+    while ((i = interlocked_xchg_add( &batch->next, 8 )) < batch->count)
+    {
+        for (end = min( i + 8, batch->count ); i < end; i++)
+        {
+            stat = &data->stats[i];
+            stat->ret = get_file_info( data->names[data->stat_pos + i].unix_name, &stat->st, &stat->attr );
+        }
+    }
+}
+
+static void *stat_pool_thread( void *arg )
+{
+    unsigned int gen = PtrToUlong( arg );
+    struct dir_data_stat_batch *batch;
+
+    pthread_mutex_lock( &stat_pool_mutex );
+    for (;;)
+    {
+        while (gen == stat_pool_gen) pthread_cond_wait( &stat_pool_work_cond, &stat_pool_mutex );
+        gen = stat_pool_gen;
+        batch = stat_pool_batch;
+        pthread_mutex_unlock( &stat_pool_mutex );
+
+        stat_dir_data_batch( batch );
+
+        pthread_mutex_lock( &stat_pool_mutex );
+        if (!--stat_pool_busy) pthread_cond_signal( &stat_pool_done_cond );
+    }
+    return NULL;
+}
+
+/* start the helper threads if not done yet; dir_section must be held by caller */
+static unsigned int start_stat_pool(void)
+{
+    unsigned int max_threads = min( MAX_DIR_DATA_STAT_THREADS, NtCurrentTeb()->Peb->NumberOfProcessors - 1 );
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t sigset, old_set;
+
+    if (stat_pool_threads >= max_threads) return stat_pool_threads;
+
+    /* these threads don't have a TEB, make sure they never receive signals */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_BLOCK, &sigset, &old_set );
+    pthread_attr_init( &attr );
+    pthread_attr_setstacksize( &attr, 64 * 1024 );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    pthread_mutex_lock( &stat_pool_mutex );
+    while (stat_pool_threads < max_threads &&
+           !pthread_create( &thread, &attr, stat_pool_thread, ULongToPtr( stat_pool_gen )))
+        stat_pool_threads++;
+    pthread_mutex_unlock( &stat_pool_mutex );
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+    return stat_pool_threads;
+}
+
+/***********************************************************************
+ *           prefetch_dir_data_stats
+ *
+ * Retrieve the file information for up to count entries, starting at the current
+ * position. The first few entries are timed, and if stat() turns out to be slow,
+ * as on network or cold filesystems, the rest of a large batch is shared with a
+ * few persistent helper threads to overlap the calls. On a warm local filesystem
+ * everything is done on the calling thread.
+ * dir_section must be held by caller, and the current directory set to the listed one.
+ */
+static void prefetch_dir_data_stats( struct dir_data *data, unsigned int count )
+{
+    struct dir_data_stat_batch batch;
+    LARGE_INTEGER start, end;
+    unsigned int probe;
+
+    if (data->pos >= data->stat_pos && data->pos < data->stat_pos + data->stat_count) return;
+
+    count = max( 1, min( count, min( dir_data_stat_max_batch, data->count - data->pos )));
+    if (count > data->stat_size)
+    {
+        unsigned int new_size = max( count, data->stat_size * 2 );
+        struct dir_data_stat *new_stats;
+
+        if (!(new_stats = RtlAllocateHeap( GetProcessHeap(), 0, new_size * sizeof(*new_stats) )))
+            count = data->stat_size;
+        else
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, data->stats );
+            data->stats = new_stats;
+            data->stat_size = new_size;
+        }
+    }
+    data->stat_pos = data->pos;
+    data->stat_count = 0;
+    if (!count) return;
+
+    batch.data  = data;
+    batch.count = probe = min( count, dir_data_stat_probe );
+    batch.next  = 0;
+
+    NtQueryPerformanceCounter( &start, NULL );
+    stat_dir_data_batch( &batch );
+    NtQueryPerformanceCounter( &end, NULL );
+
+    batch.count = count;
+    batch.next  = probe;
+
+    if (count - probe >= dir_data_stat_thread_batch &&
+        end.QuadPart - start.QuadPart >= probe * dir_data_stat_slow &&
+        NtCurrentTeb()->Peb->NumberOfProcessors > 1 && start_stat_pool())
+    {
+        pthread_mutex_lock( &stat_pool_mutex );
+        stat_pool_batch = &batch;
+        stat_pool_busy = stat_pool_threads;
+        stat_pool_gen++;
+        pthread_cond_broadcast( &stat_pool_work_cond );
+        pthread_mutex_unlock( &stat_pool_mutex );
+
+        stat_dir_data_batch( &batch );
+
+        pthread_mutex_lock( &stat_pool_mutex );
+        while (stat_pool_busy) pthread_cond_wait( &stat_pool_done_cond, &stat_pool_mutex );
+        pthread_mutex_unlock( &stat_pool_mutex );
+    }
+    else stat_dir_data_batch( &batch );
+
+    data->stat_count = count;
+}
+
+
 /***********************************************************************
  *           get_dir_data_entry
  *
@@ -1498,8 +1670,18 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     union file_directory_info *info;
     struct stat st;
     ULONG name_len, start, dir_size, attributes;
+    int ret;
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    if (dir_data->pos >= dir_data->stat_pos && dir_data->pos < dir_data->stat_pos + dir_data->stat_count)
+    {
+        const struct dir_data_stat *stat = &dir_data->stats[dir_data->pos - dir_data->stat_pos];
+        st = stat->st;
+        attributes = stat->attr;
+        ret = stat->ret;
+    }
+    else ret = get_file_info( names->unix_name, &st, &attributes );
+
+    if (ret == -1)
     {
         TRACE( "file no longer exists %s\n", names->unix_name );
         return STATUS_SUCCESS;
@@ -1996,11 +2178,16 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
         if (!(status = get_cached_dir_data( handle, &data, fd, mask )))
         {
             union file_directory_info *last_info = NULL;
+            unsigned int batch = single_entry ? 1 : length / dir_info_align( dir_info_size( info_class, 16 ));
 
             if (restart_scan) data->pos = 0;
 
+            /* file information is only prefetched for the duration of the call */
+            data->stat_count = 0;
+
             while (!status && data->pos < data->count)
             {
+                prefetch_dir_data_stats( data, batch );
                 status = get_dir_data_entry( data, buffer, io, length, info_class, &last_info );
                 if (!status || status == STATUS_BUFFER_OVERFLOW) data->pos++;
                 if (single_entry) break;
@@ -2024,6 +2211,267 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 }
 
 
+/* cache of the names of the directories that had to be searched case-insensitively */
+
+struct dir_name_record
+{
+    unsigned int   hash;         /* hash of the lowercase name */
+    unsigned short len;          /* length of the name in chars */
+    unsigned short is_short;     /* whether this is the hashed short name of the file */
+    WCHAR          name[1];      /* lowercase name, followed by the null-terminated Unix name */
+};
+
+struct dir_name_cache
+{
+    struct list          entry;      /* entry in dir_name_caches, most recently used first */
+    struct file_identity id;         /* directory file identity */
+    time_t               mtime;      /* directory modification time */
+    long                 mtime_nsec;
+    unsigned int         count;      /* number of names */
+    unsigned int         size;       /* size of the hash table, a power of 2 */
+    unsigned int        *table;      /* hash table of offsets in the data buffer, plus one */
+    char                *data;       /* name records */
+    unsigned int         data_size;  /* allocated size of the data buffer */
+    unsigned int         data_pos;   /* used size of the data buffer */
+};
+
+#define MAX_DIR_NAME_CACHES 16
+
+static struct list dir_name_caches = LIST_INIT( dir_name_caches );
+static unsigned int nb_dir_name_caches;
+static unsigned int dir_name_cache_hits;
+static unsigned int dir_name_cache_misses;
+
+static RTL_CRITICAL_SECTION dir_name_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG dir_name_cache_critsect_debug =
+{
+    0, 0, &dir_name_cache_section,
+    { &dir_name_cache_critsect_debug.ProcessLocksList, &dir_name_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": dir_name_cache_section") }
+};
+static RTL_CRITICAL_SECTION dir_name_cache_section = { &dir_name_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
+static inline long get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static unsigned int hash_dir_name( const WCHAR *name, int len )
+{
+    unsigned int hash = 0x811c9dc5;
+    while (len--) hash = (hash ^ *name++) * 0x01000193;
+    return hash;
+}
+
+static inline struct dir_name_record *get_dir_name_record( struct dir_name_cache *cache, unsigned int offset )
+{
+    return (struct dir_name_record *)(cache->data + offset - 1);
+}
+
+static inline unsigned int get_dir_name_record_size( const struct dir_name_record *record )
+{
+    const char *unix_name = (const char *)(record->name + record->len);
+    return (FIELD_OFFSET( struct dir_name_record, name[record->len] ) + strlen(unix_name) + 1 + 7) & ~7;
+}
+
+static void free_dir_name_cache( struct dir_name_cache *cache )
+{
+    RtlFreeHeap( GetProcessHeap(), 0, cache->table );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->data );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+/* add a name to a directory name cache; the name must already be lowercase */
+static BOOL add_dir_name( struct dir_name_cache *cache, const WCHAR *name, int len,
+                          const char *unix_name, BOOL is_short )
+{
+    struct dir_name_record *record;
+    unsigned int pos, hash = hash_dir_name( name, len );
+    unsigned int size = (FIELD_OFFSET( struct dir_name_record, name[len] ) + strlen(unix_name) + 1 + 7) & ~7;
+
+    if (cache->data_pos + size > cache->data_size)
+    {
+        unsigned int new_size = max( cache->data_size * 2, cache->data_pos + size );
+        char *new_data;
+
+        if (cache->data) new_data = RtlReAllocateHeap( GetProcessHeap(), 0, cache->data, new_size );
+        else new_data = RtlAllocateHeap( GetProcessHeap(), 0, new_size );
+        if (!new_data) return FALSE;
+        cache->data = new_data;
+        cache->data_size = new_size;
+    }
+    if (cache->count * 2 >= cache->size)
+    {
+        unsigned int new_size = max( 64, cache->size * 2 ), *new_table, offset;
+
+        if (!(new_table = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, new_size * sizeof(*new_table) )))
+            return FALSE;
+        /* rehash in insertion order so that the first matching name is still found first */
+        for (offset = 0; offset < cache->data_pos; offset += get_dir_name_record_size( record ))
+        {
+            record = (struct dir_name_record *)(cache->data + offset);
+            pos = record->hash & (new_size - 1);
+            while (new_table[pos]) pos = (pos + 1) & (new_size - 1);
+            new_table[pos] = offset + 1;
+        }
+        RtlFreeHeap( GetProcessHeap(), 0, cache->table );
+        cache->table = new_table;
+        cache->size = new_size;
+    }
+
+    record = (struct dir_name_record *)(cache->data + cache->data_pos);
+    record->hash = hash;
+    record->len = len;
+    record->is_short = is_short;
+    memcpy( record->name, name, len * sizeof(WCHAR) );
+    strcpy( (char *)(record->name + len), unix_name );
+
+    /* linear probing keeps the first name added in front, like the readdir() order */
+    pos = hash & (cache->size - 1);
+    while (cache->table[pos]) pos = (pos + 1) & (cache->size - 1);
+    cache->table[pos] = cache->data_pos + 1;
+    cache->data_pos += size;
+    cache->count++;
+    return TRUE;
+}
+
+/* read a directory and store the names of all its files */
+static struct dir_name_cache *create_dir_name_cache( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN], short_nameW[12];
+    struct dir_name_cache *cache;
+    UNICODE_STRING str;
+    BOOLEAN spaces;
+    struct dirent *de;
+    DIR *dir;
+    int i, len;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+    cache->id.dev = st->st_dev;
+    cache->id.ino = st->st_ino;
+    cache->mtime = st->st_mtime;
+    cache->mtime_nsec = get_mtime_nsec( st );
+
+    if (!(dir = opendir( unix_name )))
+    {
+        free_dir_name_cache( cache );
+        return NULL;
+    }
+    str.Buffer = buffer;
+    str.MaximumLength = sizeof(buffer);
+    while ((de = readdir( dir )))
+    {
+        len = ntdll_umbstowcs( 0, de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
+        str.Length = len * sizeof(WCHAR);
+        if (!RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) || spaces)
+        {
+            int short_len = hash_short_file_name( &str, short_nameW );
+            for (i = 0; i < short_len; i++) short_nameW[i] = tolowerW( short_nameW[i] );
+            if (!add_dir_name( cache, short_nameW, short_len, de->d_name, TRUE )) goto failed;
+        }
+        for (i = 0; i < len; i++) buffer[i] = tolowerW( buffer[i] );
+        if (!add_dir_name( cache, buffer, len, de->d_name, FALSE )) goto failed;
+    }
+    closedir( dir );
+    return cache;
+
+failed:
+    closedir( dir );
+    free_dir_name_cache( cache );
+    return NULL;
+}
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Look up a file through the cached names of a directory, refreshing the
+ * cache if the directory has been modified. Returns STATUS_NOT_IMPLEMENTED
+ * if the directory has to be searched the normal way.
+ */
+static NTSTATUS find_file_in_dir_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                        BOOLEAN check_short_names )
+{
+    WCHAR lower_name[MAX_DIR_ENTRY_LEN];
+    struct dir_name_cache *cache;
+    struct dir_name_record *record;
+    struct stat st;
+    unsigned int i, hash;
+    NTSTATUS status = STATUS_OBJECT_PATH_NOT_FOUND;
+    BOOL keep;
+
+    if (length > MAX_DIR_ENTRY_LEN) return STATUS_NOT_IMPLEMENTED;
+    if (stat( unix_name, &st ) == -1) return STATUS_NOT_IMPLEMENTED;
+
+    /* a directory modified during the last second could be modified again */
+    /* without changing its time stamp, so don't cache it yet */
+    keep = (st.st_mtime < time(NULL) - 1);
+
+    RtlEnterCriticalSection( &dir_name_cache_section );
+
+    LIST_FOR_EACH_ENTRY( cache, &dir_name_caches, struct dir_name_cache, entry )
+    {
+        if (cache->id.dev != st.st_dev || cache->id.ino != st.st_ino) continue;
+        list_remove( &cache->entry );
+        nb_dir_name_caches--;
+        if (keep && cache->mtime == st.st_mtime && cache->mtime_nsec == get_mtime_nsec( &st ))
+        {
+            dir_name_cache_hits++;
+            goto found;
+        }
+        free_dir_name_cache( cache );
+        break;
+    }
+
+    if (!keep)
+    {
+        RtlLeaveCriticalSection( &dir_name_cache_section );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    dir_name_cache_misses++;
+    TRACE( "reading %s, %u hits %u misses\n", debugstr_a(unix_name),
+           dir_name_cache_hits, dir_name_cache_misses );
+    if (!(cache = create_dir_name_cache( unix_name, &st )))
+    {
+        RtlLeaveCriticalSection( &dir_name_cache_section );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+found:
+    for (i = 0; i < length; i++) lower_name[i] = tolowerW( name[i] );
+    hash = hash_dir_name( lower_name, length );
+    for (i = hash & (cache->size - 1); cache->size && cache->table[i]; i = (i + 1) & (cache->size - 1))
+    {
+        record = get_dir_name_record( cache, cache->table[i] );
+        if (record->hash != hash || record->len != length) continue;
+        if (record->is_short && !check_short_names) continue;
+        if (memcmp( record->name, lower_name, length * sizeof(WCHAR) )) continue;
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, (const char *)(record->name + record->len) );
+        status = STATUS_SUCCESS;
+        break;
+    }
+
+    list_add_head( &dir_name_caches, &cache->entry );
+    if (++nb_dir_name_caches > MAX_DIR_NAME_CACHES)
+    {
+        cache = LIST_ENTRY( list_tail( &dir_name_caches ), struct dir_name_cache, entry );
+        list_remove( &cache->entry );
+        nb_dir_name_caches--;
+        free_dir_name_cache( cache );
+    }
+
+    RtlLeaveCriticalSection( &dir_name_cache_section );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2040,6 +2488,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     DIR *dir;
     struct dirent *de;
     struct stat st;
+    NTSTATUS status;
     int ret, used_default;
 
     /* try a shortcut for this directory */
@@ -2134,6 +2583,10 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    status = find_file_in_dir_cache( unix_name, pos, name, length, is_name_8_dot_3 );
+    if (status == STATUS_SUCCESS) goto success;
+    if (status != STATUS_NOT_IMPLEMENTED) goto not_found;
+
     if (!(dir = opendir( unix_name )))
     {
         if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
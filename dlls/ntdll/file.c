@@ -555,6 +555,33 @@ static NTSTATUS FILE_AsyncReadService( void *user, IO_STATUS_BLOCK *iosb, NTSTAT
     return status;
 }
 
+/***********************************************************************
+ *           notify_io_completion
+ *
+ * Signal the event, queue the user APC and post the completion port packet
+ * of an I/O request that completed without going through the server, all
+ * in a single server call.
+ */
+static void notify_io_completion( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                                  IO_STATUS_BLOCK *io, ULONG_PTR cvalue, NTSTATUS status, ULONG total )
+{
+    if (!event && !apc && !cvalue) return;
+
+    SERVER_START_REQ( add_fd_completion )
+    {
+        req->handle      = wine_server_obj_handle( handle );
+        req->cvalue      = cvalue;
+        req->status      = status;
+        req->information = total;
+        req->event       = wine_server_obj_handle( event );
+        req->apc         = wine_server_client_ptr( apc );
+        req->apc_arg     = wine_server_client_ptr( apc_user );
+        req->iosb        = wine_server_client_ptr( io );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
 /* do a read call through the server */
 static NTSTATUS server_read_file( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_context,
                                   IO_STATUS_BLOCK *io, void *buffer, ULONG size,
@@ -1006,18 +1033,16 @@ err:
         io_status->u.Status = status;
         io_status->Information = total;
         TRACE("= SUCCESS (%u)\n", total);
-        if (hEvent) NtSetEvent( hEvent, NULL );
-        if (apc && !status) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc,
-                                              (ULONG_PTR)apc_user, (ULONG_PTR)io_status, 0 );
+        notify_io_completion( hFile, hEvent, status ? NULL : apc, apc_user, io_status,
+                              send_completion ? cvalue : 0, status, total );
     }
     else
     {
         TRACE("= 0x%08x\n", status);
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
+        if (send_completion) notify_io_completion( hFile, 0, NULL, NULL, NULL, cvalue, status, total );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
-
     return status;
 }
 
@@ -1088,10 +1113,8 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
     io_status->u.Status = status;
     io_status->Information = total;
     TRACE("= 0x%08x (%u)\n", status, total);
-    if (event) NtSetEvent( event, NULL );
-    if (apc) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc,
-                               (ULONG_PTR)apc_user, (ULONG_PTR)io_status, 0 );
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
+    notify_io_completion( file, event, apc, apc_user, io_status,
+                          send_completion ? cvalue : 0, status, total );
 
     return STATUS_PENDING;
 
@@ -1400,18 +1423,16 @@ err:
         io_status->u.Status = status;
         io_status->Information = total;
         TRACE("= SUCCESS (%u)\n", total);
-        if (hEvent) NtSetEvent( hEvent, NULL );
-        if (apc) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc,
-                                   (ULONG_PTR)apc_user, (ULONG_PTR)io_status, 0 );
+        notify_io_completion( hFile, hEvent, apc, apc_user, io_status,
+                              send_completion ? cvalue : 0, status, total );
     }
     else
     {
         TRACE("= 0x%08x\n", status);
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
+        if (send_completion) notify_io_completion( hFile, 0, NULL, NULL, NULL, cvalue, status, total );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
-
     return status;
 }
 
@@ -1492,18 +1513,16 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         io_status->u.Status = status;
         io_status->Information = total;
         TRACE("= SUCCESS (%u)\n", total);
-        if (event) NtSetEvent( event, NULL );
-        if (apc) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc,
-                                   (ULONG_PTR)apc_user, (ULONG_PTR)io_status, 0 );
+        notify_io_completion( file, event, apc, apc_user, io_status,
+                              send_completion ? cvalue : 0, status, total );
     }
     else
     {
         TRACE("= 0x%08x\n", status);
         if (status != STATUS_PENDING && event) NtResetEvent( event, NULL );
+        if (send_completion) notify_io_completion( file, 0, NULL, NULL, NULL, cvalue, status, total );
     }
 
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
-
     return status;
 }
 
@@ -83,6 +83,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_LFH_MAGIC        0x48464c
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -164,6 +165,7 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    struct heap_lfh *lfh;           /* Low-fragmentation front end, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -178,6 +180,20 @@ typedef struct tagHEAP
 #define HEAP_VALIDATE_ALL     0x20000000
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
+/* The low-fragmentation front end keeps freed small blocks in lock-free caches,
+ * one per block size and per thread affinity slot. Cached blocks remain in use
+ * as far as the arena code is concerned, and are marked with ARENA_LFH_MAGIC. */
+#define HEAP_LFH_MAX_SIZE     0x400   /* largest block size handled by the front end */
+#define HEAP_LFH_NB_BINS      ((HEAP_LFH_MAX_SIZE - HEAP_MIN_DATA_SIZE) / ALIGNMENT + 1)
+#define HEAP_LFH_NB_SLOTS     8       /* number of thread affinity slots */
+#define HEAP_LFH_BIN_BYTES    0x4000  /* max number of bytes cached in a bin */
+#define HEAP_LFH_REFILL       8       /* number of blocks allocated at once for an empty bin */
+
+struct heap_lfh
+{
+    SLIST_HEADER bins[HEAP_LFH_NB_SLOTS][HEAP_LFH_NB_BINS];
+};
+
 static HEAP *processHeap;  /* main process heap */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
@@ -296,7 +312,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_LFH_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -1058,6 +1075,160 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 }
 
 
+/***********************************************************************
+ *           allocate_block
+ *
+ * Allocate an in-use block of the specified rounded size from the arenas.
+ * The heap must be locked by the caller.
+ */
+static ARENA_INUSE *allocate_block( HEAP *heap, SIZE_T rounded_size, SUBHEAP **subheap )
+{
+    ARENA_FREE *pArena;
+    ARENA_INUSE *pInUse;
+
+    if (!(pArena = HEAP_FindFreeBlock( heap, rounded_size, subheap ))) return NULL;
+
+    /* Remove the arena from the free list */
+
+    list_remove( &pArena->entry );
+
+    /* Build the in-use arena */
+
+    pInUse = (ARENA_INUSE *)pArena;
+
+    /* in-use arena is smaller than free arena,
+     * so we have to add the difference to the size */
+    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
+    pInUse->magic = ARENA_INUSE_MAGIC;
+
+    /* Shrink the block */
+
+    HEAP_ShrinkBlock( *subheap, pInUse, rounded_size );
+    return pInUse;
+}
+
+
+/***********************************************************************
+ *           get_lfh_bin
+ *
+ * Get the front end cache for a given block size in the current thread affinity slot.
+ */
+static inline SLIST_HEADER *get_lfh_bin( struct heap_lfh *lfh, SIZE_T size )
+{
+    ULONG slot = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread ) / 4;
+    return &lfh->bins[slot % HEAP_LFH_NB_SLOTS][(size - HEAP_MIN_DATA_SIZE) / ALIGNMENT];
+}
+
+
+/***********************************************************************
+ *           lfh_allocate_block
+ *
+ * Allocate a small block through the low-fragmentation front end. The heap
+ * lock is only taken when the cache is empty, to refill it from the arenas.
+ */
+static void *lfh_allocate_block( HEAP *heap, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    SLIST_HEADER *bin = get_lfh_bin( heap->lfh, rounded_size );
+    ARENA_INUSE *arena, *block;
+    SLIST_ENTRY *entry;
+    SUBHEAP *subheap;
+    unsigned int i;
+
+    if ((entry = RtlInterlockedPopEntrySList( bin )))
+    {
+        arena = (ARENA_INUSE *)entry - 1;
+        arena->magic = ARENA_INUSE_MAGIC;
+    }
+    else
+    {
+        if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heap->critSection );
+        arena = allocate_block( heap, rounded_size, &subheap );
+        for (i = 1; arena && i < HEAP_LFH_REFILL; i++)
+        {
+            if (!(block = allocate_block( heap, rounded_size, &subheap ))) break;
+            if ((block->size & ARENA_SIZE_MASK) != rounded_size)
+            {
+                /* not split from a larger block, don't keep it around */
+                HEAP_MakeInUseBlockFree( subheap, block );
+                break;
+            }
+            block->magic = ARENA_LFH_MAGIC;
+            RtlInterlockedPushEntrySList( bin, (SLIST_ENTRY *)(block + 1) );
+        }
+        if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heap->critSection );
+        if (!arena) return NULL;
+    }
+
+    arena->unused_bytes = (arena->size & ARENA_SIZE_MASK) - size;
+    notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( arena + 1, size, arena->unused_bytes, flags );
+    return arena + 1;
+}
+
+
+/***********************************************************************
+ *           lfh_free_block
+ *
+ * Return a small block to the low-fragmentation front end cache.
+ * Returns FALSE if the block has to be freed through the arenas instead.
+ * The block must already have been validated as belonging to one of the
+ * subheaps of this heap, since a cached block is handed out again as is.
+ */
+static BOOL lfh_free_block( HEAP *heap, ARENA_INUSE *arena )
+{
+    SLIST_HEADER *bin;
+    SIZE_T size;
+
+    size = arena->size & ARENA_SIZE_MASK;
+    if (size < HEAP_MIN_DATA_SIZE || size > HEAP_LFH_MAX_SIZE) return FALSE;
+
+    bin = get_lfh_bin( heap->lfh, size );
+    if (RtlQueryDepthSList( bin ) >= HEAP_LFH_BIN_BYTES / size) return FALSE;
+
+    arena->magic = ARENA_LFH_MAGIC;
+    RtlInterlockedPushEntrySList( bin, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           enable_lfh
+ *
+ * Enable the low-fragmentation front end for a heap.
+ */
+static NTSTATUS enable_lfh( HEAP *heap )
+{
+    struct heap_lfh *lfh = NULL;
+    SIZE_T size = sizeof(*lfh);
+    unsigned int i, j;
+    NTSTATUS status;
+
+    if (heap->lfh) return STATUS_SUCCESS;
+
+    /* the front end bypasses the heap lock and the block checks */
+    if (heap->flags & (HEAP_NO_SERIALIZE | HEAP_SHARED | HEAP_VALIDATE | HEAP_PAGE_ALLOCS |
+                       HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED))
+        return STATUS_UNSUCCESSFUL;
+    if (RUNNING_ON_VALGRIND) return STATUS_UNSUCCESSFUL;
+
+    if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&lfh, 4, &size,
+                                           MEM_COMMIT, PAGE_READWRITE )))
+        return status;
+
+    for (i = 0; i < HEAP_LFH_NB_SLOTS; i++)
+        for (j = 0; j < HEAP_LFH_NB_BINS; j++)
+            RtlInitializeSListHead( &lfh->bins[i][j] );
+
+    if (interlocked_cmpxchg_ptr( (void **)&heap->lfh, lfh, NULL ))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), (void **)&lfh, &size, MEM_RELEASE );
+    }
+    TRACE( "enabled low-fragmentation heap for %p\n", heap );
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           HEAP_IsValidArenaPtr
  *
@@ -1214,7 +1385,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_LFH_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1429,7 +1601,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_LFH_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1638,6 +1810,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh)
+    {
+        size = 0;
+        addr = heapPtr->lfh;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1664,7 +1842,6 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
  */
 PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 {
-    ARENA_FREE *pArena;
     ARENA_INUSE *pInUse;
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
@@ -1683,6 +1860,14 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && rounded_size <= HEAP_LFH_MAX_SIZE)
+    {
+        void *ret = lfh_allocate_block( heapPtr, flags, size, rounded_size );
+        if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1696,7 +1881,7 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 
     /* Locate a suitable free block */
 
-    if (!(pArena = HEAP_FindFreeBlock( heapPtr, rounded_size, &subheap )))
+    if (!(pInUse = allocate_block( heapPtr, rounded_size, &subheap )))
     {
         TRACE("(%p,%08x,%08lx): returning NULL\n",
                   heap, flags, size  );
@@ -1705,22 +1890,6 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
         return NULL;
     }
 
-    /* Remove the arena from the free list */
-
-    list_remove( &pArena->entry );
-
-    /* Build the in-use arena */
-
-    pInUse = (ARENA_INUSE *)pArena;
-
-    /* in-use arena is smaller than free arena,
-     * so we have to add the difference to the size */
-    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
-    pInUse->magic = ARENA_INUSE_MAGIC;
-
-    /* Shrink the block */
-
-    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
     pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
@@ -1766,6 +1935,7 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
@@ -1777,7 +1947,7 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
-    else
+    else if (!heapPtr->lfh || !lfh_free_block( heapPtr, pInUse ))
         HEAP_MakeInUseBlockFree( subheap, pInUse );
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
@@ -2133,7 +2303,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2181,7 +2352,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_LFH_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2246,6 +2417,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2254,7 +2427,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_PARAMETER;
+        *(ULONG *)info = heapPtr->lfh ? 2 : 0; /* low-fragmentation or standard heap */
         return STATUS_SUCCESS;
 
     default:
@@ -2268,6 +2442,29 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        TRACE("%p HeapCompatibilityInformation %p %ld\n", heap, info, size);
+
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_PARAMETER;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* standard heap, cannot be restored once the front end is enabled */
+            return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:  /* low-fragmentation heap */
+            return enable_lfh( heapPtr );
+        default:
+            FIXME("unsupported heap compatibility mode %u\n", *(ULONG *)info);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
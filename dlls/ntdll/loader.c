@@ -23,10 +23,18 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -102,6 +110,8 @@ typedef struct _wine_modref
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
+    DWORD                *export_hash;      /* hash table of exported names, built on first use */
+    DWORD                 export_hash_mask; /* size of the hash table minus one */
 } WINE_MODREF;
 
 /* info about the current builtin dll load */
@@ -135,6 +145,8 @@ static WINE_MODREF *cached_modref;
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
+static int profile_fd = -1;  /* file receiving the loader profile events */
+
 static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_MODREF** pwm );
 static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved );
 static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
@@ -376,6 +388,85 @@ static void call_ldr_notifications( ULONG reason, LDR_MODULE *module )
     }
 }
 
+/***********************************************************************
+ *           init_loader_profile
+ *
+ * Open the file specified by WINELOADERPROFILE. The time spent in the various
+ * steps of loading each module is appended to it in the Chrome trace event
+ * format, so that it can be loaded in chrome://tracing or similar tools.
+ */
+static void init_loader_profile(void)
+{
+    const char *name = getenv( "WINELOADERPROFILE" );
+
+    if (!name || !*name) return;
+    /* the closing bracket is optional in the trace format, so every process simply
+     * appends, and only the one that creates the file writes the opening bracket */
+    if ((profile_fd = open( name, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0666 )) != -1)
+        write( profile_fd, "[\n", 2 );
+    else if (errno != EEXIST || (profile_fd = open( name, O_WRONLY | O_APPEND )) == -1)
+    {
+        WARN( "cannot open loader profile %s\n", debugstr_a(name) );
+        return;
+    }
+    fcntl( profile_fd, F_SETFD, FD_CLOEXEC );
+}
+
+
+/***********************************************************************
+ *           profile_time
+ *
+ * Return the start or end time of a profiled operation, if profiling is enabled.
+ */
+static inline ULONGLONG profile_time(void)
+{
+    LARGE_INTEGER counter;
+
+    if (profile_fd == -1) return 0;
+    NtQueryPerformanceCounter( &counter, NULL );
+    return counter.QuadPart;
+}
+
+
+/***********************************************************************
+ *           profile_event
+ *
+ * Log a profiled operation on a module, along with an operation-specific count.
+ * Modules are always identified by their FullDllName, so that all the events
+ * of a module can be matched; operations done before the module is created
+ * are logged once it exists.
+ * The loader_section must be locked while calling this function.
+ */
+static void profile_event( const char *event, const WINE_MODREF *wm, ULONGLONG start, ULONGLONG end,
+                           ULONG_PTR count )
+{
+    char buffer[2 * MAX_PATH + 256], name[2 * MAX_PATH], ts[24];
+    const WCHAR *module = wm->ldr.FullDllName.Buffer;
+    ULONGLONG time = start / 10;  /* the counter frequency is 10 MHz */
+    unsigned int i, len;
+
+    if (profile_fd == -1) return;
+
+    for (i = len = 0; module && module[i] && len < sizeof(name) - 2; i++)
+    {
+        if (module[i] == '\\' || module[i] == '"') name[len++] = '\\';
+        name[len++] = (module[i] >= 0x20 && module[i] < 0x7f) ? module[i] : '?';
+    }
+    name[len] = 0;
+
+    /* timestamps are in microseconds */
+    if (time >= 1000000) sprintf( ts, "%u%06u", (unsigned int)(time / 1000000), (unsigned int)(time % 1000000) );
+    else sprintf( ts, "%u", (unsigned int)time );
+
+    len = sprintf( buffer, "{\"name\":\"%s\",\"cat\":\"loader\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+                   "\"ts\":%s,\"dur\":%u,\"args\":{\"module\":\"%s\",\"count\":%lu}},\n",
+                   event, HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess ),
+                   HandleToULong( NtCurrentTeb()->ClientId.UniqueThread ), ts,
+                   (unsigned int)((end - start) / 10), name, count );
+    write( profile_fd, buffer, len );
+}
+
+
 /*************************************************************************
  *		get_modref
  *
@@ -605,6 +696,54 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 31 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		get_export_hash
+ *
+ * Get the hash table of the exported names of a module, building it if needed.
+ * Small export tables are left to the binary search.
+ * The loader_section must be locked while calling this function.
+ */
+static WINE_MODREF *get_export_hash( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    WINE_MODREF *wm;
+    DWORD i, pos, size = 64;
+
+    if (exports->NumberOfNames < 32) return NULL;
+    if (!(wm = get_modref( module ))) return NULL;
+    if (wm->export_hash) return wm;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                             size * sizeof(*wm->export_hash) )))
+        return NULL;
+    wm->export_hash_mask = size - 1;
+
+    /* store index + 1 so that zero marks an empty slot */
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( module, names[i] )) & wm->export_hash_mask;
+        while (wm->export_hash[pos]) pos = (pos + 1) & wm->export_hash_mask;
+        wm->export_hash[pos] = i + 1;
+    }
+    TRACE( "built export hash for %s, %u names\n",
+           debugstr_w(wm->ldr.BaseDllName.Buffer), exports->NumberOfNames );
+    return wm;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -617,6 +756,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
+    WINE_MODREF *wm;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -626,7 +766,21 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
+    /* then look it up in the hash table */
+    if ((wm = get_export_hash( module, exports )))
+    {
+        DWORD pos = hash_export_name( name ) & wm->export_hash_mask;
+
+        for ( ; wm->export_hash[pos]; pos = (pos + 1) & wm->export_hash_mask)
+        {
+            DWORD index = wm->export_hash[pos] - 1;
+            if (!strcmp( get_rva( module, names[index] ), name ))
+                return find_ordinal_export( module, exports, exp_size, ordinals[index], load_path );
+        }
+        return NULL;
+    }
+
+    /* or fall back to a binary search */
     while (min <= max)
     {
         int res, pos = (min + max) / 2;
@@ -1013,11 +1167,14 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     DWORD size;
     NTSTATUS status;
     ULONG_PTR cookie;
+    ULONGLONG start;
 
     if (!(wm->ldr.Flags & LDR_DONT_RESOLVE_REFS)) return STATUS_SUCCESS;  /* already done */
     wm->ldr.Flags &= ~LDR_DONT_RESOLVE_REFS;
 
+    start = profile_time();
     wm->ldr.TlsIndex = alloc_tls_slot( &wm->ldr );
+    if (wm->ldr.TlsIndex != -1) profile_event( "tls", wm, start, profile_time(), wm->ldr.TlsIndex );
 
     if (!(imports = RtlImageDirectoryEntryToData( wm->ldr.BaseAddress, TRUE,
                                                   IMAGE_DIRECTORY_ENTRY_IMPORT, &size )))
@@ -1038,6 +1195,7 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     /* load the imported modules. They are automatically
      * added to the modref list of the process.
      */
+    start = profile_time();
     prev = current_modref;
     current_modref = wm;
     status = STATUS_SUCCESS;
@@ -1054,6 +1212,7 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     }
     current_modref = prev;
     if (wm->ldr.ActivationContext) RtlDeactivateActivationContext( 0, cookie );
+    profile_event( "imports", wm, start, profile_time(), nb_imports );
     return status;
 }
 
@@ -1307,10 +1466,12 @@ static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved )
     if (status == STATUS_SUCCESS)
     {
         WINE_MODREF *prev = current_modref;
+        ULONGLONG start = profile_time();
         current_modref = wm;
 
         call_ldr_notifications( LDR_DLL_NOTIFICATION_REASON_LOADED, &wm->ldr );
         status = MODULE_InitDLL( wm, DLL_PROCESS_ATTACH, lpReserved );
+        profile_event( "attach", wm, start, profile_time(), (ULONG)status );
         if (status == STATUS_SUCCESS)
         {
             wm->ldr.Flags |= LDR_PROCESS_ATTACHED;
@@ -1844,7 +2005,7 @@ static void set_security_cookie( void *module, SIZE_T len )
     }
 }
 
-static NTSTATUS perform_relocations( void *module, SIZE_T len )
+static NTSTATUS perform_relocations( void *module, SIZE_T len, ULONG *count )
 {
     IMAGE_NT_HEADERS *nt;
     char *base;
@@ -1905,6 +2066,7 @@ static NTSTATUS perform_relocations( void *module, SIZE_T len )
             WARN( "invalid address %p in relocation %p\n", get_rva( module, rel->VirtualAddress ), rel );
             return STATUS_ACCESS_VIOLATION;
         }
+        *count += (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
         rel = LdrProcessRelocationBlock( get_rva( module, rel->VirtualAddress ),
                                          (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT),
                                          (USHORT *)(rel + 1), delta );
@@ -1966,6 +2128,8 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     WINE_MODREF *wm;
     NTSTATUS status;
     pe_image_info_t image_info;
+    ULONGLONG map_start, map_end, reloc_start = 0, reloc_end = 0;
+    ULONG reloc_count = 0;
 
     TRACE("Trying native dll %s\n", debugstr_w(name));
 
@@ -1976,7 +2140,9 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     if (status != STATUS_SUCCESS) return status;
 
     module = NULL;
+    map_start = profile_time();
     status = virtual_map_section( mapping, &module, 0, 0, NULL, &len, PAGE_EXECUTE_READ, &image_info );
+    map_end = profile_time();
     NtClose( mapping );
 
     if ((status == STATUS_SUCCESS || status == STATUS_IMAGE_NOT_AT_BASE) &&
@@ -1989,7 +2155,11 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     /* perform base relocation, if necessary */
 
     if (status == STATUS_IMAGE_NOT_AT_BASE)
-        status = perform_relocations( module, len );
+    {
+        reloc_start = profile_time();
+        status = perform_relocations( module, len, &reloc_count );
+        reloc_end = profile_time();
+    }
 
     if (status != STATUS_SUCCESS)
     {
@@ -2005,6 +2175,9 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
         return STATUS_NO_MEMORY;
     }
 
+    profile_event( "map", wm, map_start, map_end, len );
+    if (reloc_end) profile_event( "relocate", wm, reloc_start, reloc_end, reloc_count );
+
     wm->dev = st->st_dev;
     wm->ino = st->st_ino;
     if (image_info.loader_flags) wm->ldr.Flags |= LDR_COR_IMAGE;
@@ -2075,6 +2248,7 @@ static NTSTATUS load_builtin_dll( LPCWSTR load_path, LPCWSTR path, HANDLE file,
     DWORD len, i;
     void *handle;
     struct builtin_load_info info, *prev_info;
+    ULONGLONG start, end;
 
     /* Fix the name in case we have a full path and extension */
     name = path;
@@ -2109,7 +2283,9 @@ static NTSTATUS load_builtin_dll( LPCWSTR load_path, LPCWSTR path, HANDLE file,
         prev_info = builtin_load_info;
         info.filename = nt_name.Buffer + 4;  /* skip \??\ */
         builtin_load_info = &info;
+        start = profile_time();
         handle = wine_dlopen( unix_name.Buffer, RTLD_NOW, error, sizeof(error) );
+        end = profile_time();
         builtin_load_info = prev_info;
         RtlFreeUnicodeString( &nt_name );
         RtlFreeHeap( GetProcessHeap(), 0, unix_name.Buffer );
@@ -2137,7 +2313,9 @@ static NTSTATUS load_builtin_dll( LPCWSTR load_path, LPCWSTR path, HANDLE file,
 
         prev_info = builtin_load_info;
         builtin_load_info = &info;
+        start = profile_time();
         handle = wine_dll_load( dllname, error, sizeof(error), &file_exists );
+        end = profile_time();
         builtin_load_info = prev_info;
         if (!handle)
         {
@@ -2189,6 +2367,7 @@ static NTSTATUS load_builtin_dll( LPCWSTR load_path, LPCWSTR path, HANDLE file,
         info.wm->ldr.SectionHandle = handle;
     }
 
+    profile_event( "dlopen", info.wm, start, end, 0 );
     *pwm = info.wm;
     return STATUS_SUCCESS;
 }
@@ -3054,6 +3233,7 @@ static void free_modref( WINE_MODREF *wm )
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -3513,6 +3693,7 @@ void __wine_process_init(void)
     umask( FILE_umask );
 
     load_global_options();
+    init_loader_profile();
 
     /* setup the load callback and create ntdll modref */
     wine_dll_set_callback( load_builtin_callback );
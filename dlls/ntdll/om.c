@@ -20,6 +20,7 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <stdarg.h>
 #include <stdlib.h>
@@ -43,6 +44,123 @@
 WINE_DEFAULT_DEBUG_CHANNEL(ntdll);
 
 
+/*
+ *	Handle information cache
+ *
+ * The object type and the handle flags can't change while a handle is
+ * open (the flags only through NtSetInformationObject), so they are
+ * cached on the client side to avoid a server call on every query.
+ */
+
+#define HANDLE_CACHE_FLAGS      0x0003  /* HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE */
+#define HANDLE_CACHE_HAS_FLAGS  0x0004  /* the flags are valid */
+#define HANDLE_CACHE_HAS_TYPE   0x0008  /* the type is valid */
+#define HANDLE_CACHE_TYPE_SHIFT 8       /* index in type_names plus one */
+
+#define HANDLE_CACHE_BLOCK_SIZE (65536 / sizeof(LONG))
+#define HANDLE_CACHE_BLOCKS     128
+
+static LONG *handle_cache[HANDLE_CACHE_BLOCKS];
+
+#define MAX_TYPE_NAMES 255
+
+static UNICODE_STRING type_names[MAX_TYPE_NAMES];
+static unsigned int nb_type_names;
+
+static RTL_CRITICAL_SECTION type_names_section;
+static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &type_names_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": type_names_section") }
+};
+static RTL_CRITICAL_SECTION type_names_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+/* get the cache entry of a handle, optionally allocating it */
+static LONG *get_handle_cache_entry( HANDLE handle, BOOL alloc )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    unsigned int block = idx / HANDLE_CACHE_BLOCK_SIZE;
+    LONG *ptr;
+
+    if (block >= HANDLE_CACHE_BLOCKS) return NULL;  /* pseudo-handles end up here too */
+    if (!(ptr = handle_cache[block]))
+    {
+        if (!alloc) return NULL;
+        if (!(ptr = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                     HANDLE_CACHE_BLOCK_SIZE * sizeof(*ptr) ))) return NULL;
+        if (interlocked_cmpxchg_ptr( (void **)&handle_cache[block], ptr, NULL ))
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, ptr );
+            ptr = handle_cache[block];
+        }
+    }
+    return &ptr[idx % HANDLE_CACHE_BLOCK_SIZE];
+}
+
+/* replace the bits in mask of the cache entry of a handle */
+static void update_handle_cache( HANDLE handle, LONG mask, LONG bits )
+{
+    LONG *entry = get_handle_cache_entry( handle, TRUE );
+    LONG old;
+
+    if (!entry) return;
+    do old = *entry;
+    while (interlocked_cmpxchg( entry, (old & ~mask) | bits, old ) != old);
+}
+
+/* invalidate the cache entry of a closed handle */
+static void invalidate_handle_cache( HANDLE handle )
+{
+    LONG *entry = get_handle_cache_entry( handle, FALSE );
+
+    if (entry) interlocked_xchg( entry, 0 );
+}
+
+/* get the index of a type name in the type_names array, adding it if needed; returns -1 on failure */
+static int get_type_name_index( const UNICODE_STRING *name )
+{
+    unsigned int i;
+    WCHAR *str;
+    int ret = -1;
+
+    RtlEnterCriticalSection( &type_names_section );
+    for (i = 0; i < nb_type_names; i++)
+        if (RtlEqualUnicodeString( &type_names[i], name, FALSE )) break;
+    if (i < nb_type_names) ret = i;
+    else if (i < MAX_TYPE_NAMES && (str = RtlAllocateHeap( GetProcessHeap(), 0, name->Length )))
+    {
+        memcpy( str, name->Buffer, name->Length );
+        type_names[i].Buffer = str;
+        type_names[i].Length = type_names[i].MaximumLength = name->Length;
+        nb_type_names++;
+        ret = i;
+    }
+    RtlLeaveCriticalSection( &type_names_section );
+    return ret;
+}
+
+/* fill the type information of an object from the cache; returns STATUS_NOT_FOUND on a cache miss */
+static NTSTATUS get_cached_type_info( HANDLE handle, OBJECT_TYPE_INFORMATION *p, ULONG len, ULONG *used_len )
+{
+    LONG *entry = get_handle_cache_entry( handle, FALSE );
+    const UNICODE_STRING *name;
+    LONG data;
+
+    if (!entry || !((data = *entry) & HANDLE_CACHE_HAS_TYPE)) return STATUS_NOT_FOUND;
+
+    name = &type_names[(data >> HANDLE_CACHE_TYPE_SHIFT) - 1];
+    if (used_len) *used_len = sizeof(*p) + name->Length + sizeof(WCHAR);
+    if (sizeof(*p) + name->Length + sizeof(WCHAR) > len) return STATUS_INFO_LENGTH_MISMATCH;
+    p->TypeName.Buffer = (WCHAR *)(p + 1);
+    p->TypeName.Length = name->Length;
+    p->TypeName.MaximumLength = name->Length + sizeof(WCHAR);
+    memcpy( p->TypeName.Buffer, name->Buffer, name->Length );
+    p->TypeName.Buffer[name->Length / sizeof(WCHAR)] = 0;
+    return STATUS_SUCCESS;
+}
+
+
 /*
  *	Generic object functions
  */
@@ -154,6 +272,10 @@ NTSTATUS WINAPI NtQueryObject(IN HANDLE handle,
     case ObjectTypeInformation:
         {
             OBJECT_TYPE_INFORMATION *p = ptr;
+            int index;
+
+            status = get_cached_type_info( handle, p, len, used_len );
+            if (status != STATUS_NOT_FOUND) break;
 
             SERVER_START_REQ( get_object_type )
             {
@@ -181,6 +303,9 @@ NTSTATUS WINAPI NtQueryObject(IN HANDLE handle,
                         p->TypeName.MaximumLength = res + sizeof(WCHAR);
                         p->TypeName.Buffer[res / sizeof(WCHAR)] = 0;
                         if (used_len) *used_len = sizeof(*p) + p->TypeName.MaximumLength;
+                        if ((index = get_type_name_index( &p->TypeName )) != -1)
+                            update_handle_cache( handle, ~(HANDLE_CACHE_FLAGS | HANDLE_CACHE_HAS_FLAGS),
+                                                 HANDLE_CACHE_HAS_TYPE | ((index + 1) << HANDLE_CACHE_TYPE_SHIFT) );
                     }
                 }
             }
@@ -190,9 +315,20 @@ NTSTATUS WINAPI NtQueryObject(IN HANDLE handle,
     case ObjectDataInformation:
         {
             OBJECT_DATA_INFORMATION* p = ptr;
+            LONG *entry = get_handle_cache_entry( handle, FALSE );
+            LONG data;
 
             if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
+            if (entry && ((data = *entry) & HANDLE_CACHE_HAS_FLAGS))
+            {
+                p->InheritHandle = (data & HANDLE_FLAG_INHERIT) != 0;
+                p->ProtectFromClose = (data & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
+                if (used_len) *used_len = sizeof(*p);
+                status = STATUS_SUCCESS;
+                break;
+            }
+
             SERVER_START_REQ( set_handle_info )
             {
                 req->handle = wine_server_obj_handle( handle );
@@ -204,6 +340,8 @@ NTSTATUS WINAPI NtQueryObject(IN HANDLE handle,
                     p->InheritHandle = (reply->old_flags & HANDLE_FLAG_INHERIT) != 0;
                     p->ProtectFromClose = (reply->old_flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
                     if (used_len) *used_len = sizeof(*p);
+                    update_handle_cache( handle, HANDLE_CACHE_FLAGS | HANDLE_CACHE_HAS_FLAGS,
+                                         HANDLE_CACHE_HAS_FLAGS | (reply->old_flags & HANDLE_CACHE_FLAGS) );
                 }
             }
             SERVER_END_REQ;
@@ -246,6 +384,9 @@ NTSTATUS WINAPI NtSetInformationObject(IN HANDLE handle,
                 if (p->InheritHandle)    req->flags |= HANDLE_FLAG_INHERIT;
                 if (p->ProtectFromClose) req->flags |= HANDLE_FLAG_PROTECT_FROM_CLOSE;
                 status = wine_server_call( req );
+                if (status == STATUS_SUCCESS)
+                    update_handle_cache( handle, HANDLE_CACHE_FLAGS | HANDLE_CACHE_HAS_FLAGS,
+                                         HANDLE_CACHE_HAS_FLAGS | req->flags );
             }
             SERVER_END_REQ;
         }
@@ -371,6 +512,9 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
             {
                 int fd = server_remove_fd_from_cache( source );
                 if (fd != -1) close( fd );
+                server_remove_fast_sync_from_cache( source );
+                invalidate_reg_cache( source );
+                invalidate_handle_cache( source );
             }
         }
     }
@@ -390,6 +534,9 @@ NTSTATUS close_handle( HANDLE handle )
     NTSTATUS ret;
     int fd = server_remove_fd_from_cache( handle );
 
+    server_remove_fast_sync_from_cache( handle );
+    invalidate_reg_cache( handle );
+    invalidate_handle_cache( handle );
     SERVER_START_REQ( close_handle )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -523,6 +523,124 @@ NTSTATUS WINAPI NtEnumerateValueKey( HANDLE handle, ULONG index,
 }
 
 
+/* client-side cache of value queries
+ *
+ * Entries are grouped in sets by key handle, so that closing a handle only
+ * needs to look at a single set. They are valid as long as the registry
+ * generation counter shared with the server hasn't changed, i.e. as long as
+ * no registry change happened anywhere since the value was retrieved.
+ */
+
+#define REG_CACHE_SETS      64
+#define REG_CACHE_WAYS      4
+#define REG_CACHE_MAX_NAME  64   /* in WCHARs */
+#define REG_CACHE_MAX_DATA  128  /* in bytes */
+
+struct reg_cache_entry
+{
+    HANDLE       handle;
+    unsigned int generation;
+    NTSTATUS     status;    /* STATUS_SUCCESS or STATUS_OBJECT_NAME_NOT_FOUND */
+    int          type;
+    DWORD        total;     /* data size */
+    USHORT       name_len;  /* in bytes */
+    WCHAR        name[REG_CACHE_MAX_NAME];
+    BYTE         data[REG_CACHE_MAX_DATA];
+};
+
+static struct reg_cache_entry reg_cache[REG_CACHE_SETS][REG_CACHE_WAYS];
+static unsigned int reg_cache_next_way[REG_CACHE_SETS];
+static BOOL reg_cache_used;
+
+static RTL_CRITICAL_SECTION reg_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG reg_cache_section_debug =
+{
+    0, 0, &reg_cache_section,
+    { &reg_cache_section_debug.ProcessLocksList, &reg_cache_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": reg_cache_section") }
+};
+static RTL_CRITICAL_SECTION reg_cache_section = { &reg_cache_section_debug, -1, 0, 0, 0, 0 };
+
+static inline unsigned int get_reg_cache_set( HANDLE handle )
+{
+    return ((ULONG_PTR)handle >> 2) % REG_CACHE_SETS;
+}
+
+/* look up a value in the cache, returns TRUE if found */
+static BOOL get_cached_value( HANDLE handle, const UNICODE_STRING *name, NTSTATUS *status,
+                              int *type, DWORD *total, void *data, DWORD size )
+{
+    struct reg_cache_entry *set = reg_cache[get_reg_cache_set( handle )];
+    const unsigned int *generation;
+    BOOL found = FALSE;
+    unsigned int i;
+
+    if (!reg_cache_used || !(generation = server_get_registry_generation())) return FALSE;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    for (i = 0; i < REG_CACHE_WAYS; i++)
+    {
+        if (set[i].handle != handle || set[i].generation != *(volatile const unsigned int *)generation)
+            continue;
+        if (set[i].name_len != name->Length || memcmp( set[i].name, name->Buffer, name->Length ))
+            continue;
+        *status = set[i].status;
+        *type   = set[i].type;
+        *total  = set[i].total;
+        if (data) memcpy( data, set[i].data, min( size, set[i].total ));
+        found = TRUE;
+        break;
+    }
+    RtlLeaveCriticalSection( &reg_cache_section );
+    return found;
+}
+
+/* store a value retrieved from the server in the cache */
+static void cache_value( HANDLE handle, const UNICODE_STRING *name, unsigned int generation,
+                         NTSTATUS status, int type, DWORD total, const void *data )
+{
+    unsigned int i, idx = get_reg_cache_set( handle );
+    struct reg_cache_entry *set = reg_cache[idx], *entry;
+
+    if (name->Length > sizeof(entry->name) || total > sizeof(entry->data)) return;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    for (i = 0; i < REG_CACHE_WAYS; i++)
+        if (set[i].handle == handle && set[i].name_len == name->Length &&
+            !memcmp( set[i].name, name->Buffer, name->Length )) break;
+    if (i == REG_CACHE_WAYS) i = reg_cache_next_way[idx]++ % REG_CACHE_WAYS;
+    entry = &set[i];
+    entry->handle     = handle;
+    entry->generation = generation;
+    entry->status     = status;
+    entry->type       = type;
+    entry->total      = total;
+    entry->name_len   = name->Length;
+    memcpy( entry->name, name->Buffer, name->Length );
+    if (total) memcpy( entry->data, data, total );
+    reg_cache_used = TRUE;
+    RtlLeaveCriticalSection( &reg_cache_section );
+}
+
+/***********************************************************************
+ *           invalidate_reg_cache
+ *
+ * Remove the cached values of a key handle that is being closed.
+ */
+void invalidate_reg_cache( HANDLE handle )
+{
+    struct reg_cache_entry *set = reg_cache[get_reg_cache_set( handle )];
+    unsigned int i;
+
+    if (!reg_cache_used) return;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    for (i = 0; i < REG_CACHE_WAYS; i++)
+        if (set[i].handle == handle) set[i].handle = 0;
+    RtlLeaveCriticalSection( &reg_cache_section );
+}
+
+
 /******************************************************************************
  * NtQueryValueKey [NTDLL.@]
  * ZwQueryValueKey [NTDLL.@]
@@ -536,7 +654,10 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
 {
     NTSTATUS ret;
     UCHAR *data_ptr;
-    unsigned int fixed_size, min_size;
+    unsigned int fixed_size, min_size, data_size, gen = 0;
+    const unsigned int *generation;
+    DWORD total;
+    int type;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, length );
 
@@ -574,19 +695,40 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         return STATUS_INVALID_PARAMETER;
     }
 
+    data_size = (length > fixed_size && data_ptr) ? length - fixed_size : 0;
+    if (get_cached_value( handle, name, &ret, &type, &total, data_ptr, data_size ))
+    {
+        TRACE( "returning cached value\n" );
+        if (!ret)
+        {
+            copy_key_value_info( info_class, info, length, type, name->Length, total );
+            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : total);
+            if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
+            else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
+        }
+        return ret;
+    }
+
+    /* retrieve the generation first, so that a concurrent change invalidates the entry */
+    if ((generation = server_get_registry_generation())) gen = *(volatile const unsigned int *)generation;
+
     SERVER_START_REQ( get_key_value )
     {
         req->hkey = wine_server_obj_handle( handle );
         wine_server_add_data( req, name->Buffer, name->Length );
-        if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
+        if (data_size) wine_server_set_reply( req, data_ptr, data_size );
         if (!(ret = wine_server_call( req )))
         {
             copy_key_value_info( info_class, info, length, reply->type,
                                  name->Length, reply->total );
             *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
+            if (generation && data_size >= reply->total)
+                cache_value( handle, name, gen, ret, reply->type, reply->total, data_ptr );
             if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
             else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
         }
+        else if (ret == STATUS_OBJECT_NAME_NOT_FOUND && generation)
+            cache_value( handle, name, gen, ret, 0, 0, NULL );
     }
     SERVER_END_REQ;
     return ret;
@@ -981,6 +981,190 @@ done:
 }
 
 
+/***********************************************************************/
+/* fast synchronization object cache */
+
+union fast_sync_cache_entry
+{
+    LONG data;
+    struct
+    {
+        unsigned int        index : 24;  /* slot in the shared region */
+        enum fast_sync_type type : 4;
+        unsigned int        modify : 1;  /* handle has *_MODIFY_STATE access */
+        unsigned int        sync : 1;    /* handle has SYNCHRONIZE access */
+        unsigned int        cached : 1;  /* entry is valid */
+    } s;
+};
+
+C_ASSERT( sizeof(union fast_sync_cache_entry) == sizeof(LONG) );
+
+#define FAST_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(union fast_sync_cache_entry))
+#define FAST_SYNC_CACHE_ENTRIES     (FD_CACHE_ENTRIES * FD_CACHE_BLOCK_SIZE / FAST_SYNC_CACHE_BLOCK_SIZE)
+
+static union fast_sync_cache_entry *fast_sync_cache[FAST_SYNC_CACHE_ENTRIES];
+static struct fast_sync_slot *fast_sync_slots;
+static int fast_sync_enabled = -1;
+
+/***********************************************************************
+ *           map_fast_sync_region
+ *
+ * Caller must hold fd_cache_section.
+ */
+static void map_fast_sync_region(void)
+{
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    void *ptr = MAP_FAILED;
+    int fd = -1;
+
+    SERVER_START_REQ( get_fast_sync_region )
+    {
+        if (!wine_server_call( req ))
+        {
+            size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+
+    if (fd != -1)
+    {
+        ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+    }
+    if (ptr != MAP_FAILED)
+    {
+        TRACE( "mapped fast synchronization region at %p\n", ptr );
+        fast_sync_slots = ptr;
+    }
+    fast_sync_enabled = (ptr != MAP_FAILED);
+}
+
+/***********************************************************************
+ *           server_get_fast_sync_obj
+ *
+ * Retrieve the shared slot of an event or semaphore handle. Returns
+ * STATUS_NOT_IMPLEMENTED if the object has to be handled by the server.
+ */
+NTSTATUS server_get_fast_sync_obj( HANDLE handle, struct fast_sync_slot **slot,
+                                   enum fast_sync_type *type, ACCESS_MASK *access )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    unsigned int entry = idx / FAST_SYNC_CACHE_BLOCK_SIZE;
+    union fast_sync_cache_entry cache;
+    sigset_t sigset;
+    NTSTATUS ret;
+
+    if (!fast_sync_enabled || entry >= FAST_SYNC_CACHE_ENTRIES) return STATUS_NOT_IMPLEMENTED;
+    idx %= FAST_SYNC_CACHE_BLOCK_SIZE;
+
+    if (!fast_sync_cache[entry] || !(cache.data = fast_sync_cache[entry][idx].data))
+    {
+        server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+
+        if (fast_sync_enabled == -1) map_fast_sync_region();
+        if (fast_sync_enabled && !fast_sync_cache[entry])
+        {
+            void *ptr = wine_anon_mmap( NULL, FAST_SYNC_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry),
+                                        PROT_READ | PROT_WRITE, 0 );
+            if (ptr != MAP_FAILED) fast_sync_cache[entry] = ptr;
+        }
+
+        cache.data = 0;
+        if (fast_sync_enabled && fast_sync_cache[entry] && !(cache.data = fast_sync_cache[entry][idx].data))
+        {
+            SERVER_START_REQ( get_fast_sync_obj )
+            {
+                req->handle = wine_server_obj_handle( handle );
+                if (!(ret = wine_server_call( req )))
+                {
+                    cache.s.index  = reply->index;
+                    cache.s.type   = reply->type;
+                    cache.s.modify = !!(reply->access & EVENT_MODIFY_STATE);
+                    cache.s.sync   = !!(reply->access & SYNCHRONIZE);
+                    cache.s.cached = 1;
+                }
+                else if (ret == STATUS_OBJECT_TYPE_MISMATCH)
+                {
+                    cache.s.type   = FAST_SYNC_NONE;
+                    cache.s.cached = 1;
+                }
+            }
+            SERVER_END_REQ;
+            if (cache.data) interlocked_xchg( &fast_sync_cache[entry][idx].data, cache.data );
+        }
+
+        server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    }
+
+    if (!cache.data || cache.s.type == FAST_SYNC_NONE) return STATUS_NOT_IMPLEMENTED;
+
+    /* EVENT_MODIFY_STATE and SEMAPHORE_MODIFY_STATE are the same bit */
+    *slot = &fast_sync_slots[cache.s.index];
+    *type = cache.s.type;
+    *access = (cache.s.modify ? EVENT_MODIFY_STATE : 0) | (cache.s.sync ? SYNCHRONIZE : 0);
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           server_remove_fast_sync_from_cache
+ */
+void server_remove_fast_sync_from_cache( HANDLE handle )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    unsigned int entry = idx / FAST_SYNC_CACHE_BLOCK_SIZE;
+
+    if (entry < FAST_SYNC_CACHE_ENTRIES && fast_sync_cache[entry])
+        interlocked_xchg( &fast_sync_cache[entry][idx % FAST_SYNC_CACHE_BLOCK_SIZE].data, 0 );
+}
+
+
+/***********************************************************************
+ *           server_get_registry_generation
+ *
+ * Map the registry generation counter shared with the server, which is
+ * incremented on every registry change. Returns NULL if not available.
+ */
+const unsigned int *server_get_registry_generation(void)
+{
+    static const unsigned int *generation;
+    static BOOL mapped;
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    sigset_t sigset;
+    void *ptr;
+    int fd = -1;
+
+    if (mapped) return generation;
+
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    if (!mapped)
+    {
+        SERVER_START_REQ( get_registry_generation )
+        {
+            if (!wine_server_call( req ))
+            {
+                size = reply->size;
+                fd = receive_fd( &fd_handle );
+            }
+        }
+        SERVER_END_REQ;
+
+        if (fd != -1)
+        {
+            ptr = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+            if (ptr != MAP_FAILED) generation = ptr;
+            close( fd );
+        }
+        mapped = TRUE;
+    }
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    return generation;
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle   (NTDLL.@)
  *
@@ -26,6 +26,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
@@ -42,6 +43,9 @@
 #ifdef HAVE_SCHED_H
 # include <sched.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -72,6 +76,347 @@ static inline int interlocked_dec_if_nonzero( int *dest )
     return val;
 }
 
+#ifdef __linux__
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_WAIT_BITSET 9
+#define FUTEX_WAKE_BITSET 10
+
+#define TICKSPERSEC 10000000
+
+static int futex_private = 128;  /* FUTEX_PRIVATE_FLAG */
+
+static inline int futex_wait( const int *addr, int val, struct timespec *timeout )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAIT | futex_private, val, timeout, 0, 0 );
+}
+
+static inline int futex_wake( const int *addr, int val )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE | futex_private, val, NULL, 0, 0 );
+}
+
+static inline int futex_wait_bitset( const int *addr, int val, struct timespec *timeout, int mask )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAIT_BITSET | futex_private, val, timeout, 0, mask );
+}
+
+static inline int futex_wake_bitset( const int *addr, int val, int mask )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE_BITSET | futex_private, val, NULL, 0, mask );
+}
+
+static inline int use_futexes(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        futex_wait( &supported, 10, NULL );
+        if (errno == ENOSYS)
+        {
+            futex_private = 0;
+            futex_wait( &supported, 10, NULL );
+        }
+        supported = (errno != ENOSYS);
+    }
+    return supported;
+}
+
+/* convert an NT timeout to a relative timespec */
+static void timespec_from_timeout( struct timespec *timespec, const LARGE_INTEGER *timeout )
+{
+    LARGE_INTEGER now;
+    timeout_t diff;
+
+    if ((diff = timeout->QuadPart) > 0)
+    {
+        NtQuerySystemTime( &now );
+        diff = now.QuadPart - diff;
+    }
+    if (diff > 0) diff = 0;
+    timespec->tv_sec  = -diff / TICKSPERSEC;
+    timespec->tv_nsec = (-diff % TICKSPERSEC) * 100;
+}
+
+/* fast synchronization objects live in memory shared with other processes,
+ * so they use non-private futexes */
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+#define FUTEX2_SIZE_U32 0x02
+
+struct futex_waitv
+{
+    ULONG64 val;
+    ULONG64 uaddr;
+    unsigned int flags;
+    unsigned int reserved;
+};
+
+static inline int futex_wait_shared( int *addr, int val, struct timespec *timeout )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAIT, val, timeout, 0, 0 );
+}
+
+static inline int futex_wake_shared( int *addr, int val )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE, val, NULL, 0, 0 );
+}
+
+static inline int futex_waitv( struct futex_waitv *waiters, unsigned int count, struct timespec *end )
+{
+    return syscall( __NR_futex_waitv, waiters, count, 0, end, CLOCK_MONOTONIC );
+}
+
+static int use_futex_waitv(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        supported = !(futex_waitv( NULL, 0, NULL ) == -1 && errno == ENOSYS);
+        TRACE( "futex_waitv %ssupported\n", supported ? "" : "not " );
+    }
+    return supported;
+}
+
+/* wake up the client and server threads waiting on a slot after its state changed */
+static void wake_fast_sync_waiters( HANDLE handle, struct fast_sync_slot *slot )
+{
+    if (interlocked_cmpxchg( &slot->client_waiters, 0, 0 ))
+        futex_wake_shared( &slot->state, INT_MAX );
+
+    if (interlocked_cmpxchg( &slot->server_waiters, 0, 0 ))
+    {
+        SERVER_START_REQ( wake_fast_sync_obj )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+}
+
+/* atomically change the state bits of an event, preserving the pulse count */
+static int update_fast_sync_event( struct fast_sync_slot *slot, int clear, int set )
+{
+    int cur;
+
+    do cur = slot->state;
+    while (interlocked_cmpxchg( &slot->state, (cur & ~clear) | set, cur ) != cur);
+    return cur;
+}
+
+static NTSTATUS fast_set_event( HANDLE handle )
+{
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
+    ACCESS_MASK access;
+
+    if (server_get_fast_sync_obj( handle, &slot, &type, &access )) return STATUS_NOT_IMPLEMENTED;
+    if (type == FAST_SYNC_SEMAPHORE) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    if (!(update_fast_sync_event( slot, 0, FAST_SYNC_EVENT_SIGNALED ) & FAST_SYNC_EVENT_SIGNALED))
+        wake_fast_sync_waiters( handle, slot );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_reset_event( HANDLE handle )
+{
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
+    ACCESS_MASK access;
+
+    if (server_get_fast_sync_obj( handle, &slot, &type, &access )) return STATUS_NOT_IMPLEMENTED;
+    if (type == FAST_SYNC_SEMAPHORE) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    update_fast_sync_event( slot, FAST_SYNC_EVENT_SIGNALED, 0 );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
+    ACCESS_MASK access;
+    unsigned int cur;
+
+    if (server_get_fast_sync_obj( handle, &slot, &type, &access )) return STATUS_NOT_IMPLEMENTED;
+    if (type != FAST_SYNC_SEMAPHORE) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(access & SEMAPHORE_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    do
+    {
+        cur = slot->state;
+        if (previous) *previous = cur;
+        if (cur + count < cur || cur + count > slot->max) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+    } while (interlocked_cmpxchg( &slot->state, cur + count, cur ) != cur);
+
+    if (!cur) wake_fast_sync_waiters( handle, slot );
+    return STATUS_SUCCESS;
+}
+
+/* check if an event has been pulsed since the wait started with the given state */
+static inline BOOL fast_sync_event_pulsed( int cur, int start )
+{
+    const int mask = FAST_SYNC_EVENT_SIGNALED | FAST_SYNC_EVENT_PULSED;
+    return (cur & ~mask) != (start & ~mask);
+}
+
+/* try to acquire a slot, returns TRUE if it was signaled; otherwise returns
+ * the state that was seen, for use as the futex value */
+static BOOL try_acquire_fast_sync( struct fast_sync_slot *slot, enum fast_sync_type type,
+                                   int start, int *seen )
+{
+    int cur;
+
+    for (;;)
+    {
+        cur = *seen = interlocked_cmpxchg( &slot->state, 0, 0 );
+        switch (type)
+        {
+        case FAST_SYNC_MANUAL_EVENT:
+            /* a pulse releases all the threads that were waiting */
+            return (cur & FAST_SYNC_EVENT_SIGNALED) || fast_sync_event_pulsed( cur, start );
+        case FAST_SYNC_AUTO_EVENT:
+            /* a pulse releases one of the threads that were waiting */
+            if (cur & FAST_SYNC_EVENT_SIGNALED)
+            {
+                if (interlocked_cmpxchg( &slot->state, cur & ~FAST_SYNC_EVENT_SIGNALED, cur ) == cur)
+                    return TRUE;
+            }
+            else if ((cur & FAST_SYNC_EVENT_PULSED) && fast_sync_event_pulsed( cur, start ))
+            {
+                if (interlocked_cmpxchg( &slot->state, cur & ~FAST_SYNC_EVENT_PULSED, cur ) == cur)
+                    return TRUE;
+            }
+            else return FALSE;
+            break;
+        case FAST_SYNC_SEMAPHORE:
+            *seen = 0;
+            return interlocked_dec_if_nonzero( &slot->state ) != 0;
+        default:
+            return FALSE;
+        }
+    }
+}
+
+/* wait on events and semaphores without going through the server; only
+ * non-alertable wait-any waits on fast objects are handled here */
+static NTSTATUS fast_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any,
+                           BOOLEAN alertable, const LARGE_INTEGER *timeout )
+{
+    struct fast_sync_slot *slots[MAXIMUM_WAIT_OBJECTS];
+    enum fast_sync_type types[MAXIMUM_WAIT_OBJECTS];
+    struct futex_waitv waiters[MAXIMUM_WAIT_OBJECTS];
+    int start[MAXIMUM_WAIT_OBJECTS], seen[MAXIMUM_WAIT_OBJECTS];
+    struct timespec end, timespec;
+    BOOL has_timeout = timeout && timeout->QuadPart != TIMEOUT_INFINITE;
+    ACCESS_MASK access;
+    DWORD i;
+    int ret;
+
+    if (alertable || (!wait_any && count > 1)) return STATUS_NOT_IMPLEMENTED;
+    if (count > 1 && !use_futex_waitv()) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if (server_get_fast_sync_obj( handles[i], &slots[i], &types[i], &access ))
+            return STATUS_NOT_IMPLEMENTED;
+        if (!(access & SYNCHRONIZE)) return STATUS_ACCESS_DENIED;
+        start[i] = interlocked_cmpxchg( &slots[i]->state, 0, 0 );
+        waiters[i].uaddr = (ULONG_PTR)&slots[i]->state;
+        waiters[i].flags = FUTEX2_SIZE_U32;
+        waiters[i].reserved = 0;
+    }
+
+    if (has_timeout)
+    {
+        /* futex_waitv wants an absolute monotonic time, futex_wait a relative one */
+        timespec_from_timeout( &timespec, timeout );
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        end.tv_sec += timespec.tv_sec;
+        if ((end.tv_nsec += timespec.tv_nsec) >= 1000000000)
+        {
+            end.tv_sec++;
+            end.tv_nsec -= 1000000000;
+        }
+    }
+
+    for (;;)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (try_acquire_fast_sync( slots[i], types[i], start[i], &seen[i] )) return STATUS_WAIT_0 + i;
+            waiters[i].val = (unsigned int)seen[i];
+        }
+
+        if (has_timeout)
+        {
+            clock_gettime( CLOCK_MONOTONIC, &timespec );
+            timespec.tv_sec = end.tv_sec - timespec.tv_sec;
+            if ((timespec.tv_nsec = end.tv_nsec - timespec.tv_nsec) < 0)
+            {
+                timespec.tv_sec--;
+                timespec.tv_nsec += 1000000000;
+            }
+            if (timespec.tv_sec < 0) return STATUS_TIMEOUT;
+        }
+
+        for (i = 0; i < count; i++) interlocked_xchg_add( &slots[i]->client_waiters, 1 );
+
+        if (count == 1)
+            ret = futex_wait_shared( &slots[0]->state, seen[0], has_timeout ? &timespec : NULL );
+        else
+            ret = futex_waitv( waiters, count, has_timeout ? &end : NULL );
+
+        for (i = 0; i < count; i++) interlocked_xchg_add( &slots[i]->client_waiters, -1 );
+
+        if (ret == -1 && errno == ETIMEDOUT)
+        {
+            for (i = 0; i < count; i++)
+                if (try_acquire_fast_sync( slots[i], types[i], start[i], &seen[i] )) return STATUS_WAIT_0 + i;
+            return STATUS_TIMEOUT;
+        }
+    }
+}
+
+#else
+
+static inline int use_futexes(void)
+{
+    return 0;
+}
+
+static inline NTSTATUS fast_set_event( HANDLE handle )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_reset_event( HANDLE handle )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any,
+                                  BOOLEAN alertable, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif
+
 /* creates a struct security_descriptor and contained information in one contiguous piece of memory */
 NTSTATUS alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                   data_size_t *ret_len )
@@ -266,6 +611,10 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
     NTSTATUS ret;
+
+    if ((ret = fast_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -346,6 +695,9 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 
     /* FIXME: set NumberOfThreadsReleased */
 
+    if ((ret = fast_set_event( handle )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -366,6 +718,9 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+    if ((ret = fast_reset_event( handle )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1022,9 +1377,13 @@ static NTSTATUS wait_objects( DWORD count, const HANDLE *handles,
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if ((ret = fast_wait( count, handles, wait_any, alertable, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1331,6 +1690,65 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve as many completion messages as available, up to count,
+ * from completion object's queue in a single server call
+ *
+ * PARAMS
+ *      port      [I] HANDLE to I/O completion object
+ *      info      [O] array of retrieved completion messages
+ *      count     [I] number of entries in the array
+ *      written   [O] number of retrieved messages
+ *      timeout   [I] optional wait time in NTDLL format
+ *      alertable [I] whether the wait is alertable
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    completion_msg_t buffer[64], *msgs = buffer;
+    NTSTATUS status;
+    ULONG i, ret = 0;
+
+    TRACE("(%p %p %u %p %p %u)\n", port, info, count, written, timeout, alertable);
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+    if (count > ARRAY_SIZE(buffer) &&
+        !(msgs = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*msgs) )))
+        return STATUS_NO_MEMORY;
+
+    for (;;)
+    {
+        SERVER_START_REQ( remove_completions )
+        {
+            req->handle = wine_server_obj_handle( port );
+            wine_server_set_reply( req, msgs, count * sizeof(*msgs) );
+            if (!(status = wine_server_call( req )))
+                ret = wine_server_reply_size( reply ) / sizeof(*msgs);
+        }
+        SERVER_END_REQ;
+        if (status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+
+    for (i = 0; i < ret; i++)
+    {
+        info[i].CompletionKey             = msgs[i].ckey;
+        info[i].CompletionValue           = msgs[i].cvalue;
+        info[i].IoStatusBlock.Information = msgs[i].information;
+        info[i].IoStatusBlock.u.Status    = msgs[i].status;
+    }
+    *written = ret;
+
+    if (msgs != buffer) RtlFreeHeap( GetProcessHeap(), 0, msgs );
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
@@ -1415,23 +1833,6 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE CompletionPort, IO_COMPLETION_INFORM
     return status;
 }
 
-NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                              NTSTATUS CompletionStatus, ULONG Information )
-{
-    NTSTATUS status;
-
-    SERVER_START_REQ( add_fd_completion )
-    {
-        req->handle      = wine_server_obj_handle( hFile );
-        req->cvalue      = CompletionValue;
-        req->status      = CompletionStatus;
-        req->information = Information;
-        status = wine_server_call( req );
-    }
-    SERVER_END_REQ;
-    return status;
-}
-
 /******************************************************************
  *              RtlRunOnceInitialize (NTDLL.@)
  */
@@ -1600,6 +2001,247 @@ DWORD WINAPI RtlRunOnceExecuteOnce( RTL_RUN_ONCE *once, PRTL_RUN_ONCE_INIT_FN fu
 #define srwlock_key_shared(lock)      (&lock->Ptr)
 #endif
 
+#ifdef __linux__
+
+/* When futexes are available the lock uses a different layout:
+ *
+ * 32 31            16               0
+ *  ________________ ________________
+ * | X| #exclusive  |    #shared     |
+ *  ¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯
+ * X is set while the lock is owned exclusively, #exclusive counts the
+ * threads waiting for exclusive access and #shared the shared owners.
+ * Exclusive and shared waiters sleep on the lock itself using different
+ * futex bitsets, and exclusive waiters have priority over new shared owners.
+ */
+
+#define SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT     0x80000000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK 0x7fff0000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC  0x00010000
+#define SRWLOCK_FUTEX_SHARED_OWNERS_MASK     0x0000ffff
+#define SRWLOCK_FUTEX_SHARED_OWNERS_INC      0x00000001
+
+/* Futex bitsets. */
+#define SRWLOCK_FUTEX_BITSET_EXCLUSIVE  1
+#define SRWLOCK_FUTEX_BITSET_SHARED     2
+
+static NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old, new;
+    NTSTATUS ret;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(int *)lock;
+        if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) && !(old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+        {
+            /* not locked exclusive or shared, we can try to grab it */
+            new = old | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT;
+            ret = STATUS_SUCCESS;
+        }
+        else
+        {
+            new = old;
+            ret = STATUS_TIMEOUT;
+        }
+    } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+    return ret;
+}
+
+static NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old, new;
+    BOOLEAN wait;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    /* increment the exclusive waiter count */
+    do
+    {
+        old = *(int *)lock;
+        new = old + SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+        if (!(new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+    } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+    for (;;)
+    {
+        do
+        {
+            old = *(int *)lock;
+            if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) && !(old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+            {
+                /* not locked exclusive or shared, we can try to grab it */
+                new = (old | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) - SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+                wait = FALSE;
+            }
+            else
+            {
+                new = old;
+                wait = TRUE;
+            }
+        } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+        if (!wait) return STATUS_SUCCESS;
+
+        futex_wait_bitset( (int *)lock, new, NULL, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int new, old;
+    NTSTATUS ret;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(int *)lock;
+        if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) && !(old & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+        {
+            /* not locked exclusive, and no exclusive waiters, we can try to grab it */
+            new = old + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+            if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+            ret = STATUS_SUCCESS;
+        }
+        else
+        {
+            new = old;
+            ret = STATUS_TIMEOUT;
+        }
+    } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+    return ret;
+}
+
+static NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int old, new;
+    BOOLEAN wait;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (;;)
+    {
+        do
+        {
+            old = *(int *)lock;
+            if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) && !(old & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+            {
+                /* not locked exclusive, and no exclusive waiters, we can try to grab it */
+                new = old + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+                if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+                wait = FALSE;
+            }
+            else
+            {
+                new = old;
+                wait = TRUE;
+            }
+        } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+        if (!wait) return STATUS_SUCCESS;
+
+        futex_wait_bitset( (int *)lock, new, NULL, SRWLOCK_FUTEX_BITSET_SHARED );
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(int *)lock;
+        if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT))
+        {
+            ERR("Lock %p is not owned exclusive! (%#x)\n", lock, old);
+            return STATUS_RESOURCE_NOT_OWNED;
+        }
+        new = old & ~SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT;
+    } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+    /* exclusive waiters are woken first, one at a time */
+    if (new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)
+        futex_wake_bitset( (int *)lock, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    else
+        futex_wake_bitset( (int *)lock, INT_MAX, SRWLOCK_FUTEX_BITSET_SHARED );
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(int *)lock;
+        if (old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT)
+        {
+            ERR("Lock %p is owned exclusive! (%#x)\n", lock, old);
+            return STATUS_RESOURCE_NOT_OWNED;
+        }
+        else if (!(old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+        {
+            ERR("Lock %p is not owned shared! (%#x)\n", lock, old);
+            return STATUS_RESOURCE_NOT_OWNED;
+        }
+        new = old - SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+    } while (interlocked_cmpxchg( (int *)lock, new, old ) != old);
+
+    /* only bother waking if the last shared owner left and there are exclusive waiters */
+    if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK) && (new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+        futex_wake_bitset( (int *)lock, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+
+    return STATUS_SUCCESS;
+}
+
+#else
+
+static inline NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif
+
 static inline void srwlock_check_invalid( unsigned int val )
 {
     /* Throw exception if it's impossible to acquire/release this lock. */
@@ -1694,6 +2336,9 @@ void WINAPI RtlInitializeSRWLock( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    if (fast_acquire_srw_exclusive( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (srwlock_lock_exclusive( (unsigned int *)&lock->Ptr, SRWLOCK_RES_EXCLUSIVE ))
         NtWaitForKeyedEvent( keyed_event, srwlock_key_exclusive(lock), FALSE, NULL );
 }
@@ -1708,6 +2353,10 @@ void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+
+    if (fast_acquire_srw_shared( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     /* Acquires a shared lock. If it's currently not possible to add elements to
      * the shared queue, then request exclusive access instead. */
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
@@ -1738,6 +2387,14 @@ void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    NTSTATUS ret;
+
+    if ((ret = fast_release_srw_exclusive( lock )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (ret) RtlRaiseStatus( ret );
+        return;
+    }
+
     srwlock_leave_exclusive( lock, srwlock_unlock_exclusive( (unsigned int *)&lock->Ptr,
                              - SRWLOCK_RES_EXCLUSIVE ) - SRWLOCK_RES_EXCLUSIVE );
 }
@@ -1747,6 +2404,14 @@ void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
 {
+    NTSTATUS ret;
+
+    if ((ret = fast_release_srw_shared( lock )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (ret) RtlRaiseStatus( ret );
+        return;
+    }
+
     srwlock_leave_shared( lock, srwlock_lock_exclusive( (unsigned int *)&lock->Ptr,
                           - SRWLOCK_RES_SHARED ) - SRWLOCK_RES_SHARED );
 }
@@ -1760,6 +2425,11 @@ void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
  */
 BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    NTSTATUS ret;
+
+    if ((ret = fast_try_acquire_srw_exclusive( lock )) != STATUS_NOT_IMPLEMENTED)
+        return (ret == STATUS_SUCCESS);
+
     return interlocked_cmpxchg( (int *)&lock->Ptr, SRWLOCK_MASK_IN_EXCLUSIVE |
                                 SRWLOCK_RES_EXCLUSIVE, 0 ) == 0;
 }
@@ -1770,6 +2440,11 @@ BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 BOOLEAN WINAPI RtlTryAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+    NTSTATUS ret;
+
+    if ((ret = fast_try_acquire_srw_shared( lock )) != STATUS_NOT_IMPLEMENTED)
+        return (ret == STATUS_SUCCESS);
+
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
     {
         if (val & SRWLOCK_MASK_EXCLUSIVE_QUEUE)
@@ -1780,6 +2455,54 @@ BOOLEAN WINAPI RtlTryAcquireSRWLockShared( RTL_SRWLOCK *lock )
     return TRUE;
 }
 
+#ifdef __linux__
+
+/* When futexes are available the condition variable is a sequence number
+ * that is incremented on every wake, waiters sleep until it changes. */
+
+static NTSTATUS fast_wait_cv( RTL_CONDITION_VARIABLE *variable, int val, const LARGE_INTEGER *timeout )
+{
+    struct timespec timespec;
+    int ret;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    if (timeout && timeout->QuadPart != TIMEOUT_INFINITE)
+    {
+        timespec_from_timeout( &timespec, timeout );
+        ret = futex_wait( (int *)&variable->Ptr, val, &timespec );
+    }
+    else
+        ret = futex_wait( (int *)&variable->Ptr, val, NULL );
+
+    if (ret == -1 && errno == ETIMEDOUT)
+        return STATUS_TIMEOUT;
+    return STATUS_WAIT_0;
+}
+
+static NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    interlocked_xchg_add( (int *)&variable->Ptr, 1 );
+    futex_wake( (int *)&variable->Ptr, count );
+    return STATUS_SUCCESS;
+}
+
+#else
+
+static inline NTSTATUS fast_wait_cv( RTL_CONDITION_VARIABLE *variable, int val, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif
+
 /***********************************************************************
  *           RtlInitializeConditionVariable   (NTDLL.@)
  *
@@ -1813,6 +2536,9 @@ void WINAPI RtlInitializeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
+    if (fast_wake_cv( variable, 1 ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (interlocked_dec_if_nonzero( (int *)&variable->Ptr ))
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1824,7 +2550,12 @@ void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeAllConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
-    int val = interlocked_xchg( (int *)&variable->Ptr, 0 );
+    int val;
+
+    if (fast_wake_cv( variable, INT_MAX ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
+    val = interlocked_xchg( (int *)&variable->Ptr, 0 );
     while (val-- > 0)
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1848,6 +2579,17 @@ NTSTATUS WINAPI RtlSleepConditionVariableCS( RTL_CONDITION_VARIABLE *variable, R
                                              const LARGE_INTEGER *timeout )
 {
     NTSTATUS status;
+
+    if (use_futexes())
+    {
+        int val = *(int *)&variable->Ptr;
+
+        RtlLeaveCriticalSection( crit );
+        status = fast_wait_cv( variable, val, timeout );
+        RtlEnterCriticalSection( crit );
+        return status;
+    }
+
     interlocked_xchg_add( (int *)&variable->Ptr, 1 );
     RtlLeaveCriticalSection( crit );
 
@@ -1885,6 +2627,25 @@ NTSTATUS WINAPI RtlSleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable,
                                               const LARGE_INTEGER *timeout, ULONG flags )
 {
     NTSTATUS status;
+
+    if (use_futexes())
+    {
+        int val = *(int *)&variable->Ptr;
+
+        if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
+            RtlReleaseSRWLockShared( lock );
+        else
+            RtlReleaseSRWLockExclusive( lock );
+
+        status = fast_wait_cv( variable, val, timeout );
+
+        if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
+            RtlAcquireSRWLockShared( lock );
+        else
+            RtlAcquireSRWLockExclusive( lock );
+        return status;
+    }
+
     interlocked_xchg_add( (int *)&variable->Ptr, 1 );
 
     if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
@@ -825,6 +825,155 @@ done:
     pRtlFreeUnicodeString(&ntdirname);
 }
 
+static void test_NtQueryDirectoryFile_many_files(void)
+{
+    static BYTE data[65536];
+    static const unsigned int count = 1000;
+    FILE_BOTH_DIRECTORY_INFORMATION *info;
+    char testdir[MAX_PATH], path[MAX_PATH], name[16];
+    BOOL restart = TRUE, found[1000];
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING ntdirname;
+    WCHAR testdirW[MAX_PATH];
+    IO_STATUS_BLOCK io;
+    unsigned int i, total = 0, calls = 0;
+    NTSTATUS status;
+    HANDLE dirh, file;
+    DWORD written;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, testdir );
+    strcat( testdir, "many.tmp" );
+    ret = CreateDirectoryA( testdir, NULL );
+    ok( ret, "couldn't create dir %s, error %d\n", testdir, GetLastError() );
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf( path, "%s\\f%u", testdir, i );
+        file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %d\n", path, GetLastError() );
+        WriteFile( file, data, i % 100, &written, NULL );
+        CloseHandle( file );
+    }
+    memset( found, 0, sizeof(found) );
+
+    pRtlMultiByteToUnicodeN( testdirW, sizeof(testdirW), NULL, testdir, strlen(testdir) + 1 );
+    if (!pRtlDosPathNameToNtPathName_U( testdirW, &ntdirname, NULL, NULL ))
+    {
+        ok( 0, "RtlDosPathNametoNtPathName_U failed\n" );
+        goto done;
+    }
+    InitializeObjectAttributes( &attr, &ntdirname, OBJ_CASE_INSENSITIVE, 0, NULL );
+    status = pNtOpenFile( &dirh, SYNCHRONIZE | FILE_LIST_DIRECTORY, &attr, &io, FILE_SHARE_READ,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_OPEN_FOR_BACKUP_INTENT | FILE_DIRECTORY_FILE );
+    ok( !status, "failed to open dir '%s', ret 0x%x\n", testdir, status );
+    pRtlFreeUnicodeString( &ntdirname );
+    if (status) goto done;
+
+    while (!(status = pNtQueryDirectoryFile( dirh, NULL, NULL, NULL, &io, data, sizeof(data),
+                                             FileBothDirectoryInformation, FALSE, NULL, restart )))
+    {
+        restart = FALSE;
+        calls++;
+        for (info = (FILE_BOTH_DIRECTORY_INFORMATION *)data; ;
+             info = (FILE_BOTH_DIRECTORY_INFORMATION *)((char *)info + info->NextEntryOffset))
+        {
+            if (info->FileName[0] == 'f')
+            {
+                WideCharToMultiByte( CP_ACP, 0, info->FileName, info->FileNameLength / sizeof(WCHAR),
+                                     name, sizeof(name) - 1, NULL, NULL );
+                name[info->FileNameLength / sizeof(WCHAR)] = 0;
+                i = atoi( name + 1 );
+                ok( i < count && !found[i], "unexpected file %s\n", name );
+                if (i < count)
+                {
+                    found[i] = TRUE;
+                    ok( info->EndOfFile.QuadPart == i % 100, "%s: got size %s\n",
+                        name, wine_dbgstr_longlong( info->EndOfFile.QuadPart ));
+                    ok( !(info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY), "%s: got attributes %x\n",
+                        name, info->FileAttributes );
+                    total++;
+                }
+            }
+            if (!info->NextEntryOffset) break;
+        }
+    }
+    ok( status == STATUS_NO_MORE_FILES, "NtQueryDirectoryFile failed: %x\n", status );
+    ok( total == count, "found %u files\n", total );
+    ok( calls > 1, "got all the files in %u calls\n", calls );
+    pNtClose( dirh );
+
+done:
+    for (i = 0; i < count; i++)
+    {
+        sprintf( path, "%s\\f%u", testdir, i );
+        DeleteFileA( path );
+    }
+    RemoveDirectoryA( testdir );
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    char testdir[MAX_PATH], path[MAX_PATH], path2[MAX_PATH];
+    unsigned int i;
+    HANDLE file;
+    DWORD attrs;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, testdir );
+    strcat( testdir, "lookup.tmp" );
+    ret = CreateDirectoryA( testdir, NULL );
+    ok( ret, "couldn't create dir %s, error %d\n", testdir, GetLastError() );
+
+    for (i = 0; i < 100; i++)
+    {
+        sprintf( path, "%s\\File%u.Txt", testdir, i );
+        file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %d\n", path, GetLastError() );
+        CloseHandle( file );
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sprintf( path, "%s\\fILE%u.tXT", testdir, i );
+        attrs = GetFileAttributesA( path );
+        ok( attrs != INVALID_FILE_ATTRIBUTES, "%s not found, error %d\n", path, GetLastError() );
+    }
+    sprintf( path, "%s\\file100.txt", testdir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path );
+
+    /* changes to the directory are visible to the next lookup */
+    sprintf( path, "%s\\File7.Txt", testdir );
+    ret = DeleteFileA( path );
+    ok( ret, "failed to delete %s, error %d\n", path, GetLastError() );
+    sprintf( path, "%s\\FILE7.TXT", testdir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path );
+
+    sprintf( path, "%s\\File8.Txt", testdir );
+    sprintf( path2, "%s\\Renamed8.Txt", testdir );
+    ret = MoveFileA( path, path2 );
+    ok( ret, "failed to rename %s, error %d\n", path, GetLastError() );
+    sprintf( path, "%s\\file8.txt", testdir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path );
+    sprintf( path, "%s\\rENAMED8.tXT", testdir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs != INVALID_FILE_ATTRIBUTES, "%s not found, error %d\n", path, GetLastError() );
+    ret = DeleteFileA( path );
+    ok( ret, "failed to delete %s, error %d\n", path, GetLastError() );
+
+    for (i = 0; i < 100; i++)
+    {
+        if (i == 7 || i == 8) continue;
+        sprintf( path, "%s\\FILE%u.TXT", testdir, i );
+        ret = DeleteFileA( path );
+        ok( ret, "failed to delete %s, error %d\n", path, GetLastError() );
+    }
+    ret = RemoveDirectoryA( testdir );
+    ok( ret, "failed to remove %s, error %d\n", testdir, GetLastError() );
+}
+
 static void test_redirection(void)
 {
     ULONG old, cur;
@@ -903,5 +1052,7 @@ START_TEST(directory)
     test_directory_sort( sysdir );
     test_NtQueryDirectoryFile();
     test_NtQueryDirectoryFile_case();
+    test_NtQueryDirectoryFile_many_files();
+    test_case_insensitive_lookup();
     test_redirection();
 }
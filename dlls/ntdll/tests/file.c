@@ -73,6 +73,8 @@ static NTSTATUS (WINAPI *pNtCreateIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_AT
 static NTSTATUS (WINAPI *pNtOpenIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES);
 static NTSTATUS (WINAPI *pNtQueryIoCompletion)(HANDLE, IO_COMPLETION_INFORMATION_CLASS, PVOID, ULONG, PULONG);
 static NTSTATUS (WINAPI *pNtRemoveIoCompletion)(HANDLE, PULONG_PTR, PULONG_PTR, PIO_STATUS_BLOCK, PLARGE_INTEGER);
+static NTSTATUS (WINAPI *pNtRemoveIoCompletionEx)(HANDLE, FILE_IO_COMPLETION_INFORMATION *, ULONG, ULONG *,
+                                                  LARGE_INTEGER *, BOOLEAN);
 static NTSTATUS (WINAPI *pNtSetIoCompletion)(HANDLE, ULONG_PTR, ULONG_PTR, NTSTATUS, SIZE_T);
 static NTSTATUS (WINAPI *pNtSetInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
 static NTSTATUS (WINAPI *pNtQueryInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
@@ -903,6 +905,53 @@ static void test_iocp_setcompletion(HANDLE h)
     ok( !count, "Unexpected msg count: %d\n", count );
 }
 
+static void test_iocp_remove_multiple(HANDLE h)
+{
+    FILE_IO_COMPLETION_INFORMATION info[100];
+    LARGE_INTEGER timeout;
+    NTSTATUS res;
+    ULONG i, count;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        win_skip( "NtRemoveIoCompletionEx not available\n" );
+        return;
+    }
+
+    timeout.QuadPart = 0;
+    res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx returned %x\n", res );
+
+    for (i = 0; i < 80; i++)
+    {
+        res = pNtSetIoCompletion( h, CKEY_FIRST + i, CVALUE_FIRST + i, STATUS_SUCCESS, i );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %x\n", res );
+    }
+
+    res = pNtRemoveIoCompletionEx( h, info, 30, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 30, "got count %u\n", count );
+    count = get_pending_msgs(h);
+    ok( count == 50, "Unexpected msg count: %d\n", count );
+
+    res = pNtRemoveIoCompletionEx( h, info + 30, ARRAY_SIZE(info) - 30, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 50, "got count %u\n", count );
+
+    for (i = 0; i < 80; i++)
+    {
+        ok( info[i].CompletionKey == CKEY_FIRST + i, "%u: got key %lx\n", i, info[i].CompletionKey );
+        ok( info[i].CompletionValue == CVALUE_FIRST + i, "%u: got value %lx\n", i, info[i].CompletionValue );
+        ok( U(info[i].IoStatusBlock).Status == STATUS_SUCCESS, "%u: got status %x\n",
+            i, U(info[i].IoStatusBlock).Status );
+        ok( info[i].IoStatusBlock.Information == i, "%u: got information %lu\n",
+            i, info[i].IoStatusBlock.Information );
+    }
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %d\n", count );
+}
+
 static void test_iocp_fileio(HANDLE h)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -2770,6 +2819,7 @@ static void test_iocompletion(void)
     if ( h && h != INVALID_HANDLE_VALUE)
     {
         test_iocp_setcompletion(h);
+        test_iocp_remove_multiple(h);
         test_iocp_fileio(h);
         pNtClose(h);
     }
@@ -4285,6 +4335,7 @@ START_TEST(file)
     pNtOpenIoCompletion     = (void *)GetProcAddress(hntdll, "NtOpenIoCompletion");
     pNtQueryIoCompletion    = (void *)GetProcAddress(hntdll, "NtQueryIoCompletion");
     pNtRemoveIoCompletion   = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletion");
+    pNtRemoveIoCompletionEx = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletionEx");
     pNtSetIoCompletion      = (void *)GetProcAddress(hntdll, "NtSetIoCompletion");
     pNtSetInformationFile   = (void *)GetProcAddress(hntdll, "NtSetInformationFile");
     pNtQueryInformationFile = (void *)GetProcAddress(hntdll, "NtQueryInformationFile");
@@ -1527,6 +1527,82 @@ static void test_query_object(void)
     pRtlFreeUnicodeString( &session );
 }
 
+static void test_handle_flags(void)
+{
+    OBJECT_DATA_INFORMATION info;
+    NTSTATUS status;
+    HANDLE h, h2;
+    DWORD flags;
+    BOOL ret;
+    ULONG len;
+
+    h = CreateEventA( NULL, FALSE, FALSE, NULL );
+    status = pNtQueryObject( h, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( !info.InheritHandle && !info.ProtectFromClose, "got flags %u %u\n",
+        info.InheritHandle, info.ProtectFromClose );
+
+    /* flags changed after a query must be seen by the next one */
+    ret = SetHandleInformation( h, HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE,
+                                HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE );
+    ok( ret, "SetHandleInformation failed %u\n", GetLastError() );
+    status = pNtQueryObject( h, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( info.InheritHandle && info.ProtectFromClose, "got flags %u %u\n",
+        info.InheritHandle, info.ProtectFromClose );
+    ret = GetHandleInformation( h, &flags );
+    ok( ret, "GetHandleInformation failed %u\n", GetLastError() );
+    ok( flags == (HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE), "got flags %x\n", flags );
+
+    ret = SetHandleInformation( h, HANDLE_FLAG_PROTECT_FROM_CLOSE, 0 );
+    ok( ret, "SetHandleInformation failed %u\n", GetLastError() );
+    ret = GetHandleInformation( h, &flags );
+    ok( ret, "GetHandleInformation failed %u\n", GetLastError() );
+    ok( flags == HANDLE_FLAG_INHERIT, "got flags %x\n", flags );
+    pNtClose( h );
+
+    /* a new handle, usually with the same value, must not get the flags of the closed one */
+    h2 = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ret = GetHandleInformation( h2, &flags );
+    ok( ret, "GetHandleInformation failed %u\n", GetLastError() );
+    ok( !flags, "got flags %x\n", flags );
+    pNtClose( h2 );
+
+    status = pNtQueryObject( h2, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( status == STATUS_INVALID_HANDLE, "NtQueryObject returned %x\n", status );
+}
+
+static void test_query_unnamed_object(void)
+{
+    static const WCHAR type_event[] = {'E','v','e','n','t'};
+    OBJECT_TYPE_INFORMATION *type;
+    UNICODE_STRING *str;
+    char buffer[1024];
+    NTSTATUS status;
+    HANDLE h;
+    ULONG len;
+
+    h = CreateEventA( NULL, FALSE, FALSE, NULL );
+
+    len = 0;
+    status = pNtQueryObject( h, ObjectNameInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    ok( len == sizeof(UNICODE_STRING), "unexpected len %u\n", len );
+    str = (UNICODE_STRING *)buffer;
+    ok( !str->Length, "got name %s\n", wine_dbgstr_w(str->Buffer) );
+
+    /* the type must still be available after querying the name */
+    len = 0;
+    status = pNtQueryObject( h, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    type = (OBJECT_TYPE_INFORMATION *)buffer;
+    ok( len >= sizeof(*type) + sizeof(type_event), "unexpected len %u\n", len );
+    ok( type->TypeName.Length == sizeof(type_event) &&
+        !memcmp( type->TypeName.Buffer, type_event, sizeof(type_event) ),
+        "wrong type %s\n", wine_dbgstr_w(type->TypeName.Buffer) );
+    pNtClose( h );
+}
+
 static void test_type_mismatch(void)
 {
     HANDLE h;
@@ -1586,6 +1662,66 @@ static void test_event(void)
     pNtClose(Event2);
 }
 
+static void test_many_names(void)
+{
+    static const unsigned int count = 5000;
+    NTSTATUS status;
+    UNICODE_STRING str;
+    OBJECT_ATTRIBUTES attr;
+    EVENT_BASIC_INFORMATION info;
+    HANDLE dir, *handles, h;
+    char name[32];
+    unsigned int i;
+
+    InitializeObjectAttributes( &attr, NULL, 0, 0, NULL );
+    status = pNtCreateDirectoryObject( &dir, GENERIC_ALL, &attr );
+    ok( !status, "NtCreateDirectoryObject failed %08x\n", status );
+    handles = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(*handles) );
+
+    /* names only differing in a numeric suffix, as commonly generated by applications */
+    InitializeObjectAttributes( &attr, &str, 0, dir, NULL );
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "event%u", i );
+        pRtlCreateUnicodeStringFromAsciiz( &str, name );
+        status = pNtCreateEvent( &handles[i], GENERIC_ALL, &attr, NotificationEvent, i % 2 );
+        pRtlFreeUnicodeString( &str );
+        if (status) break;
+    }
+    ok( i == count, "NtCreateEvent %u failed %08x\n", i, status );
+
+    InitializeObjectAttributes( &attr, &str, OBJ_CASE_INSENSITIVE, dir, NULL );
+    for (i = 0; i < count; i += 97)
+    {
+        sprintf( name, "EVENT%u", i );
+        pRtlCreateUnicodeStringFromAsciiz( &str, name );
+        status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+        pRtlFreeUnicodeString( &str );
+        ok( !status, "NtOpenEvent %s failed %08x\n", name, status );
+        if (status) continue;
+        status = pNtQueryEvent( h, EventBasicInformation, &info, sizeof(info), NULL );
+        ok( !status, "NtQueryEvent failed %08x\n", status );
+        ok( info.EventState == i % 2, "%s: wrong state %d\n", name, info.EventState );
+        pNtClose( h );
+    }
+
+    InitializeObjectAttributes( &attr, &str, 0, dir, NULL );
+    sprintf( name, "event%u", count );
+    pRtlCreateUnicodeStringFromAsciiz( &str, name );
+    status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+    pRtlFreeUnicodeString( &str );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "NtOpenEvent %s returned %08x\n", name, status );
+
+    for (i = 0; i < count; i++) if (handles[i]) pNtClose( handles[i] );
+    HeapFree( GetProcessHeap(), 0, handles );
+
+    pRtlCreateUnicodeStringFromAsciiz( &str, "event0" );
+    status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+    pRtlFreeUnicodeString( &str );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "NtOpenEvent event0 returned %08x\n", status );
+    pNtClose( dir );
+}
+
 static const WCHAR keyed_nameW[] = {'\\','B','a','s','e','N','a','m','e','d','O','b','j','e','c','t','s',
                                     '\\','W','i','n','e','T','e','s','t','E','v','e','n','t',0};
 
@@ -2039,8 +2175,11 @@ START_TEST(om)
     test_directory();
     test_symboliclink();
     test_query_object();
+    test_handle_flags();
+    test_query_unnamed_object();
     test_type_mismatch();
     test_event();
+    test_many_names();
     test_mutant();
     test_keyed_events();
     test_null_device();
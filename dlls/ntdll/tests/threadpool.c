@@ -634,6 +634,52 @@ static void test_tp_work(void)
     pTpReleasePool(pool);
 }
 
+static void CALLBACK work_count_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void test_tp_work_many(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    TP_WORK *work;
+    TP_POOL *pool;
+    NTSTATUS status;
+    LONG userdata;
+    int i;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+    pTpSetPoolMaxThreads(pool, 4);
+
+    work = NULL;
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    status = pTpAllocWork(&work, work_count_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    ok(work != NULL, "expected work != NULL\n");
+
+    /* post a lot of short work items, none of them should get lost */
+    userdata = 0;
+    for (i = 0; i < 100000; i++)
+        pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    ok(userdata == 100000, "expected userdata = 100000, got %u\n", userdata);
+
+    /* pending callbacks are dropped when cancelled */
+    userdata = 0;
+    for (i = 0; i < 10000; i++)
+        pTpPostWork(work);
+    pTpWaitForWork(work, TRUE);
+    ok(userdata <= 10000, "expected userdata <= 10000, got %u\n", userdata);
+
+    pTpReleaseWork(work);
+    pTpReleasePool(pool);
+}
+
 static void test_tp_work_scheduler(void)
 {
     TP_CALLBACK_ENVIRON environment;
@@ -1907,6 +1953,7 @@ START_TEST(threadpool)
 
     test_tp_simple();
     test_tp_work();
+    test_tp_work_many();
     test_tp_work_scheduler();
     test_tp_group_wait();
     test_tp_group_cancel();
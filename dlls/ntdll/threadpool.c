@@ -158,7 +158,8 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
-    /* information about the pool, locked via .pool->cs */
+    /* information about the pool, locked via .pool->cs, except that
+     * num_pending_callbacks is only ever modified with interlocked operations */
     struct list             pool_entry;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
@@ -1921,6 +1922,29 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
+    /* Increment refcount before the callback becomes visible to the workers. */
+    interlocked_inc( &object->refcount );
+
+    /* A work object with pending callbacks is already queued in the pool, so
+     * further submissions only need to bump its counter, without taking the
+     * pool lock. This is only done while some workers are idle, otherwise
+     * the locked path is needed to start new worker threads. */
+    if (object->type == TP_OBJECT_TYPE_WORK && pool->num_busy_workers < pool->num_workers)
+    {
+        LONG pending = object->num_pending_callbacks;
+
+        while (pending > 0)
+        {
+            LONG prev = interlocked_cmpxchg( &object->num_pending_callbacks, pending + 1, pending );
+            if (prev == pending)
+            {
+                RtlWakeConditionVariable( &pool->update_event );
+                return;
+            }
+            pending = prev;
+        }
+    }
+
     RtlEnterCriticalSection( &pool->cs );
 
     /* Start new worker threads if required. */
@@ -1928,9 +1952,8 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
         pool->num_workers < pool->max_workers)
         status = tp_new_worker_thread( pool );
 
-    /* Queue work item and increment refcount. */
-    interlocked_inc( &object->refcount );
-    if (!object->num_pending_callbacks++)
+    /* Queue work item. */
+    if (interlocked_inc( &object->num_pending_callbacks ) == 1)
         list_add_tail( &pool->pool, &object->pool_entry );
 
     /* Count how often the object was signaled. */
@@ -1958,10 +1981,8 @@ static void tp_object_cancel( struct threadpool_object *object )
     LONG pending_callbacks = 0;
 
     RtlEnterCriticalSection( &pool->cs );
-    if (object->num_pending_callbacks)
+    if ((pending_callbacks = interlocked_xchg( &object->num_pending_callbacks, 0 )))
     {
-        pending_callbacks = object->num_pending_callbacks;
-        object->num_pending_callbacks = 0;
         list_remove( &object->pool_entry );
 
         if (object->type == TP_OBJECT_TYPE_WAIT)
@@ -2079,7 +2100,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
             /* If further pending callbacks are queued, move the work item to
              * the end of the pool list. Otherwise remove it from the pool. */
             list_remove( &object->pool_entry );
-            if (--object->num_pending_callbacks)
+            if (interlocked_dec( &object->num_pending_callbacks ))
                 list_add_tail( &pool->pool, &object->pool_entry );
 
             /* For wait objects check if they were signaled or have timed out. */
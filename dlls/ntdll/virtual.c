@@ -73,6 +73,8 @@ struct file_view
     struct wine_rb_entry entry;  /* entry in global view tree */
     void         *base;          /* base address */
     size_t        size;          /* size in bytes */
+    size_t        gap;           /* free space between the previous view and this one */
+    size_t        max_gap;       /* largest gap in the subtree rooted at this view */
     unsigned int  protect;       /* protection for all pages at allocation time and SEC_* flags */
 };
 
@@ -451,70 +453,99 @@ static struct file_view *find_view_range( const void *addr, size_t size )
 
 
 /***********************************************************************
- *           find_free_area
+ *           fit_free_area
  *
- * Find a free area between views inside the specified range.
- * The csVirtual section must be held by caller.
+ * Check whether a free range can hold an area of the specified size
+ * once clipped to the search range and aligned.
  */
-static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+static inline void *fit_free_area( char *start, char *end, char *base, char *limit,
+                                   size_t size, size_t mask, int top_down )
 {
-    struct wine_rb_entry *first = NULL, *ptr = views_tree.root;
-    void *start;
+    char *ptr;
 
-    /* find the first (resp. last) view inside the range */
-    while (ptr)
+    if (start < base) start = base;
+    if (end > limit) end = limit;
+    if (start >= end || end - start < size) return NULL;
+
+    if (top_down) ptr = ROUND_ADDR( end - size, mask );
+    else
     {
-        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
-        if ((char *)view->base + view->size >= (char *)end)
-        {
-            end = min( end, view->base );
-            ptr = ptr->left;
-        }
-        else if (view->base <= base)
-        {
-            base = max( (char *)base, (char *)view->base + view->size );
-            ptr = ptr->right;
-        }
-        else
-        {
-            first = ptr;
-            ptr = top_down ? ptr->right : ptr->left;
-        }
+        ptr = ROUND_ADDR( start + mask, mask );
+        if (ptr < start) return NULL;  /* overflow */
     }
+    if (!ptr || ptr < start || ptr > end - size) return NULL;
+    return ptr;
+}
 
-    if (top_down)
-    {
-        start = ROUND_ADDR( (char *)end - size, mask );
-        if (start >= end || start < base) return NULL;
 
-        while (first)
-        {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
+/***********************************************************************
+ *           find_free_gap
+ *
+ * Find the first (resp. last) gap before a view of the subtree that can hold the area,
+ * skipping subtrees whose largest gap is too small.
+ * The csVirtual section must be held by caller.
+ */
+static void *find_free_gap( struct wine_rb_entry *ptr, char *base, char *end,
+                            size_t size, size_t mask, int top_down )
+{
+    struct file_view *view;
+    char *gap_start, *ret;
 
-            if ((char *)view->base + view->size <= (char *)start) break;
-            start = ROUND_ADDR( (char *)view->base - size, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || start < base) return NULL;
-            first = wine_rb_prev( first );
-        }
+    if (!ptr) return NULL;
+    view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+    if (view->max_gap < size) return NULL;
+    gap_start = (char *)view->base - view->gap;
+
+    if (top_down)
+    {
+        if ((char *)view->base + view->size < end &&
+            (ret = find_free_gap( ptr->right, base, end, size, mask, top_down )))
+            return ret;
+        if ((ret = fit_free_area( gap_start, view->base, base, end, size, mask, top_down )))
+            return ret;
+        if (gap_start > base) return find_free_gap( ptr->left, base, end, size, mask, top_down );
     }
     else
     {
-        start = ROUND_ADDR( (char *)base + mask, mask );
-        if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
+        if (gap_start > base &&
+            (ret = find_free_gap( ptr->left, base, end, size, mask, top_down )))
+            return ret;
+        if ((ret = fit_free_area( gap_start, view->base, base, end, size, mask, top_down )))
+            return ret;
+        if ((char *)view->base + view->size < end)
+            return find_free_gap( ptr->right, base, end, size, mask, top_down );
+    }
+    return NULL;
+}
 
-        while (first)
-        {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
 
-            if ((char *)view->base >= (char *)start + size) break;
-            start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
-            first = wine_rb_next( first );
-        }
+/***********************************************************************
+ *           find_free_area
+ *
+ * Find a free area between views inside the specified range.
+ * The csVirtual section must be held by caller.
+ */
+static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+{
+    struct wine_rb_entry *last = wine_rb_tail( views_tree.root );
+    char *last_end = NULL;
+    void *ret;
+
+    if (last)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( last, struct file_view, entry );
+        last_end = (char *)view->base + view->size;
+    }
+
+    /* the space after the last view isn't covered by the tree gaps */
+    if (top_down)
+    {
+        if ((ret = fit_free_area( last_end, (char *)~(UINT_PTR)0, base, end, size, mask, top_down )))
+            return ret;
+        return find_free_gap( views_tree.root, base, end, size, mask, top_down );
     }
-    return start;
+    if ((ret = find_free_gap( views_tree.root, base, end, size, mask, top_down ))) return ret;
+    return fit_free_area( last_end, (char *)~(UINT_PTR)0, base, end, size, mask, top_down );
 }
 
 
@@ -677,6 +708,62 @@ static struct file_view *alloc_view(void)
 }
 
 
+/***********************************************************************
+ *           update_view_max_gap
+ */
+static inline void update_view_max_gap( struct wine_rb_entry *ptr )
+{
+    struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+    size_t max_gap = view->gap;
+
+    if (ptr->left)
+        max_gap = max( max_gap, WINE_RB_ENTRY_VALUE( ptr->left, struct file_view, entry )->max_gap );
+    if (ptr->right)
+        max_gap = max( max_gap, WINE_RB_ENTRY_VALUE( ptr->right, struct file_view, entry )->max_gap );
+    view->max_gap = max_gap;
+}
+
+
+/***********************************************************************
+ *           update_view_gaps
+ *
+ * Recompute the largest gaps from a modified entry up to the root of the tree.
+ * Tree rotations only ever move nodes to the path from the modified entry to
+ * the root, or to direct children of that path, so this is enough to restore
+ * the max_gap invariant after an insertion or removal.
+ */
+static void update_view_gaps( struct wine_rb_entry *ptr )
+{
+    for ( ; ptr; ptr = ptr->parent)
+    {
+        if (ptr->left) update_view_max_gap( ptr->left );
+        if (ptr->right) update_view_max_gap( ptr->right );
+        update_view_max_gap( ptr );
+    }
+}
+
+
+/***********************************************************************
+ *           set_view_gap
+ *
+ * Update the gap before a view following an insertion or removal of its predecessor.
+ */
+static void set_view_gap( struct wine_rb_entry *ptr )
+{
+    struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+    struct wine_rb_entry *prev = wine_rb_prev( ptr );
+    char *prev_end = NULL;
+
+    if (prev)
+    {
+        struct file_view *prev_view = WINE_RB_ENTRY_VALUE( prev, struct file_view, entry );
+        prev_end = (char *)prev_view->base + prev_view->size;
+    }
+    view->gap = (char *)view->base - prev_end;
+    update_view_gaps( ptr );
+}
+
+
 /***********************************************************************
  *           delete_view
  *
@@ -684,9 +771,22 @@ static struct file_view *alloc_view(void)
  */
 static void delete_view( struct file_view *view ) /* [in] View */
 {
+    struct wine_rb_entry *next = wine_rb_next( &view->entry ), *fixup;
+
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
     set_page_vprot( view->base, view->size, 0 );
+
+    /* find the lowest entry whose subtree is modified by the removal */
+    if (view->entry.left && view->entry.right)
+    {
+        fixup = wine_rb_head( view->entry.right );
+        if (fixup->parent != &view->entry) fixup = fixup->parent;
+    }
+    else fixup = view->entry.parent;
+
     wine_rb_remove( &views_tree, &view->entry );
+    update_view_gaps( fixup );
+    if (next) set_view_gap( next );
     *(struct file_view **)view = next_free_view;
     next_free_view = view;
 }
@@ -700,6 +800,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
 static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t size, unsigned int vprot )
 {
     struct file_view *view;
+    struct wine_rb_entry *next;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
 
     assert( !((UINT_PTR)base & page_mask) );
@@ -733,6 +834,8 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     set_page_vprot( base, size, vprot );
 
     wine_rb_put( &views_tree, view->base, &view->entry );
+    set_view_gap( &view->entry );
+    if ((next = wine_rb_next( &view->entry ))) set_view_gap( next );
 
     *view_ret = view;
 
@@ -1358,7 +1461,8 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
  * Map an executable (PE format) image into memory.
  */
 static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T mask,
-                           pe_image_info_t *image_info, int shared_fd, BOOL removable, PVOID *addr_ptr )
+                           pe_image_info_t *image_info, int shared_fd, int image_fd,
+                           BOOL removable, PVOID *addr_ptr )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -1518,20 +1622,26 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
 
         /* Note: if the section is not aligned properly map_file_into_view will magically
          *       fall back to read(), so we don't need to check anything here.
+         *       The server provides a page-aligned copy of the image in that case,
+         *       which lets us map the section instead of reading it.
          */
         end = file_start + file_size;
         if (sec->PointerToRawData >= st.st_size ||
             end > ((st.st_size + sector_align) & ~sector_align) ||
             end < file_start ||
-            map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
-                                VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
-                                removable ) != STATUS_SUCCESS)
+            (image_fd != -1 ?
+             map_file_into_view( view, image_fd, sec->VirtualAddress, file_size, sec->VirtualAddress,
+                                 VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) :
+             map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
+                                 VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
+                                 removable )) != STATUS_SUCCESS)
         {
             ERR_(module)( "Could not map section %.8s, file probably truncated\n", sec->Name );
             goto error;
         }
 
-        if (file_size & page_mask)
+        /* the image copy is already zero-filled past the end of the section data */
+        if ((file_size & page_mask) && image_fd == -1)
         {
             end = ROUND_SIZE( 0, file_size );
             if (end > map_size) end = map_size;
@@ -1618,7 +1728,7 @@ NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG zero_bits, S
     int unix_handle = -1, needs_close;
     unsigned int vprot, sec_flags;
     struct file_view *view;
-    HANDLE shared_file;
+    HANDLE shared_file, image_file;
     LARGE_INTEGER offset;
     sigset_t sigset;
 
@@ -1655,29 +1765,35 @@ NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG zero_bits, S
         sec_flags   = reply->flags;
         full_size   = reply->size;
         shared_file = wine_server_ptr_handle( reply->shared_file );
+        image_file  = wine_server_ptr_handle( reply->image_file );
     }
     SERVER_END_REQ;
     if (res) return res;
 
-    if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL ))) goto done;
+    if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL )))
+    {
+        if (shared_file) close_handle( shared_file );
+        if (image_file) close_handle( image_file );
+        goto done;
+    }
 
     if (sec_flags & SEC_IMAGE)
     {
-        if (shared_file)
-        {
-            int shared_fd, shared_needs_close;
+        int shared_fd = -1, image_fd = -1, shared_needs_close = 0, image_needs_close = 0;
 
-            if ((res = server_get_unix_fd( shared_file, FILE_READ_DATA|FILE_WRITE_DATA,
-                                           &shared_fd, &shared_needs_close, NULL, NULL ))) goto done;
+        if (shared_file)
+            res = server_get_unix_fd( shared_file, FILE_READ_DATA|FILE_WRITE_DATA,
+                                      &shared_fd, &shared_needs_close, NULL, NULL );
+        if (!res && image_file &&
+            server_get_unix_fd( image_file, FILE_READ_DATA, &image_fd, &image_needs_close, NULL, NULL ))
+            image_fd = -1;  /* fall back to the PE file */
+        if (!res)
             res = map_image( handle, access, unix_handle, mask, image_info,
-                             shared_fd, needs_close, addr_ptr );
-            if (shared_needs_close) close( shared_fd );
-            close_handle( shared_file );
-        }
-        else
-        {
-            res = map_image( handle, access, unix_handle, mask, image_info, -1, needs_close, addr_ptr );
-        }
+                             shared_fd, image_fd, needs_close, addr_ptr );
+        if (shared_needs_close) close( shared_fd );
+        if (image_needs_close) close( image_fd );
+        if (shared_file) close_handle( shared_file );
+        if (image_file) close_handle( image_file );
         if (needs_close) close( unix_handle );
         if (res >= 0) *size_ptr = image_info->map_size;
         return res;
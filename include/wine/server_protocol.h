@@ -363,6 +363,16 @@ typedef struct
     int          high_part;
 } luid_t;
 
+
+typedef struct
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+} completion_msg_t;
+
 #define MAX_ACL_LEN 65535
 
 struct security_descriptor
@@ -1417,6 +1427,66 @@ struct open_semaphore_reply
 
 
 
+struct fast_sync_slot
+{
+    int          state;
+    unsigned int max;
+    int          server_waiters;
+    int          client_waiters;
+};
+
+#define FAST_SYNC_EVENT_SIGNALED  0x01
+#define FAST_SYNC_EVENT_PULSED    0x02
+#define FAST_SYNC_EVENT_PULSE_INC 0x04
+enum fast_sync_type
+{
+    FAST_SYNC_NONE,
+    FAST_SYNC_AUTO_EVENT,
+    FAST_SYNC_MANUAL_EVENT,
+    FAST_SYNC_SEMAPHORE
+};
+
+
+struct get_fast_sync_region_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fast_sync_region_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
+struct get_fast_sync_obj_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_fast_sync_obj_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    int          type;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+struct wake_fast_sync_obj_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct wake_fast_sync_obj_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -2255,7 +2325,9 @@ struct get_mapping_info_reply
     mem_size_t   size;
     unsigned int flags;
     obj_handle_t shared_file;
+    obj_handle_t image_file;
     /* VARARG(image,pe_image_info); */
+    char __pad_28[4];
 };
 
 
@@ -2734,6 +2806,20 @@ struct set_registry_notification_reply
 
 
 
+struct get_registry_generation_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_registry_generation_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
+
 struct create_timer_request
 {
     struct request_header __header;
@@ -5325,6 +5411,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5361,7 +5460,10 @@ struct add_fd_completion_request
     apc_param_t    cvalue;
     apc_param_t    information;
     unsigned int   status;
-    char __pad_36[4];
+    obj_handle_t   event;
+    client_ptr_t   apc;
+    client_ptr_t   apc_arg;
+    client_ptr_t   iosb;
 };
 struct add_fd_completion_reply
 {
@@ -5674,6 +5776,9 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_fast_sync_region,
+    REQ_get_fast_sync_obj,
+    REQ_wake_fast_sync_obj,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5749,6 +5854,7 @@ enum request
     REQ_unload_registry,
     REQ_save_registry,
     REQ_set_registry_notification,
+    REQ_get_registry_generation,
     REQ_create_timer,
     REQ_open_timer,
     REQ_set_timer,
@@ -5902,6 +6008,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5970,6 +6077,9 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_fast_sync_region_request get_fast_sync_region_request;
+    struct get_fast_sync_obj_request get_fast_sync_obj_request;
+    struct wake_fast_sync_obj_request wake_fast_sync_obj_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -6045,6 +6155,7 @@ union generic_request
     struct unload_registry_request unload_registry_request;
     struct save_registry_request save_registry_request;
     struct set_registry_notification_request set_registry_notification_request;
+    struct get_registry_generation_request get_registry_generation_request;
     struct create_timer_request create_timer_request;
     struct open_timer_request open_timer_request;
     struct set_timer_request set_timer_request;
@@ -6198,6 +6309,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6264,6 +6376,9 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_fast_sync_region_reply get_fast_sync_region_reply;
+    struct get_fast_sync_obj_reply get_fast_sync_obj_reply;
+    struct wake_fast_sync_obj_reply wake_fast_sync_obj_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6339,6 +6454,7 @@ union generic_reply
     struct unload_registry_reply unload_registry_reply;
     struct save_registry_reply save_registry_reply;
     struct set_registry_notification_reply set_registry_notification_reply;
+    struct get_registry_generation_reply get_registry_generation_reply;
     struct create_timer_reply create_timer_reply;
     struct open_timer_reply open_timer_reply;
     struct set_timer_reply set_timer_reply;
@@ -6492,6 +6608,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6514,6 +6631,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 555
+#define SERVER_PROTOCOL_VERSION 563
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -41,22 +41,27 @@ struct event
     struct object  obj;             /* object header */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    int           *state;           /* pointer to the signaled state (in shared memory for fast sync) */
+    unsigned int   fast_sync;       /* fast synchronization slot, or 0 */
 };
 
 static void event_dump( struct object *obj, int verbose );
 static struct object_type *event_get_type( struct object *obj );
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int event_map_access( struct object *obj, unsigned int access );
 static int event_signal( struct object *obj, unsigned int access);
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
     sizeof(struct event),      /* size */
     event_dump,                /* dump */
     event_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    event_add_queue,           /* add_queue */
+    event_remove_queue,        /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
     event_signal,              /* signal */
@@ -69,7 +74,7 @@ static const struct object_ops event_ops =
     default_unlink_name,       /* unlink_name */
     no_open_file,              /* open_file */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -118,7 +123,10 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
         {
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
-            event->signaled     = initial_state;
+            event->signaled     = initial_state ? FAST_SYNC_EVENT_SIGNALED : 0;
+            event->state        = &event->signaled;
+            if ((event->fast_sync = alloc_fast_sync_slot( event->signaled, 0 )))
+                event->state = get_fast_sync_state( event->fast_sync );
         }
     }
     return event;
@@ -129,32 +137,69 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+/* retrieve the fast synchronization slot of an event object */
+enum fast_sync_type get_event_fast_sync( struct object *obj, unsigned int *index )
+{
+    struct event *event = (struct event *)obj;
+
+    if (obj->ops != &event_ops || !event->fast_sync) return FAST_SYNC_NONE;
+    *index = event->fast_sync;
+    return event->manual_reset ? FAST_SYNC_MANUAL_EVENT : FAST_SYNC_AUTO_EVENT;
+}
+
+/* atomically change the state bits of an event, which clients may modify concurrently */
+static int update_event_state( struct event *event, int clear, int set, int add )
+{
+    int cur;
+
+    do cur = *event->state;
+    while (interlocked_cmpxchg( event->state, (((unsigned int)cur + add) & ~clear) | set, cur ) != cur);
+    return cur;
+}
+
 void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    update_event_state( event, 0, FAST_SYNC_EVENT_SIGNALED, 0 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+
+    if (!event->fast_sync || !has_fast_sync_client_waiters( event->fast_sync ))
+    {
+        update_event_state( event, FAST_SYNC_EVENT_SIGNALED, 0, 0 );
+        return;
+    }
+
+    /* client waiters can't run before the event is reset again, so bump the pulse
+     * count instead; they compare it to the value they started waiting with */
+    if (event->manual_reset)
+        update_event_state( event, FAST_SYNC_EVENT_SIGNALED, 0, FAST_SYNC_EVENT_PULSE_INC );
+    else if (update_event_state( event, FAST_SYNC_EVENT_SIGNALED, 0, 0 ) & FAST_SYNC_EVENT_SIGNALED)
+        /* not taken by a server waiter, let one of the client waiters take the pulse */
+        update_event_state( event, 0, FAST_SYNC_EVENT_PULSED, FAST_SYNC_EVENT_PULSE_INC );
+    else
+        return;
+    wake_fast_sync_slot( event->fast_sync );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    update_event_state( event, 0, FAST_SYNC_EVENT_SIGNALED, 0 );
+    if (event->fast_sync) wake_fast_sync_slot( event->fast_sync );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    update_event_state( event, FAST_SYNC_EVENT_SIGNALED, 0, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d%s\n",
+             event->manual_reset, *event->state & FAST_SYNC_EVENT_SIGNALED, event->fast_sync ? " fast" : "" );
 }
 
 static struct object_type *event_get_type( struct object *obj )
@@ -164,19 +209,39 @@ static struct object_type *event_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->fast_sync) add_fast_sync_waiter( event->fast_sync );
+    return add_queue( obj, entry );
+}
+
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->fast_sync) remove_fast_sync_waiter( event->fast_sync );
+    remove_queue( obj, entry );
+}
+
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    /* a wait on an auto-reset event in shared memory takes the signal right away, since
+     * a client could take it before the wait is satisfied; wait-all acquires it later */
+    if (event->fast_sync && !event->manual_reset && get_wait_queue_select_op( entry ) != SELECT_WAIT_ALL)
+        return acquire_fast_sync_slot( event->fast_sync, FAST_SYNC_AUTO_EVENT );
+    return (*event->state & FAST_SYNC_EVENT_SIGNALED) != 0;
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    /* Reset if it's an auto-reset event; in shared memory it has already been taken */
+    if (!event->manual_reset && !event->fast_sync) event->signaled = 0;
 }
 
 static unsigned int event_map_access( struct object *obj, unsigned int access )
@@ -202,6 +267,13 @@ static int event_signal( struct object *obj, unsigned int access )
     return 1;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    free_fast_sync_slot( event->fast_sync );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -337,7 +409,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = (*event->state & FAST_SYNC_EVENT_SIGNALED) != 0;
 
     release_object( event );
 }
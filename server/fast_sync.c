@@ -0,0 +1,315 @@
+/*
+ * Fast synchronization objects in shared memory
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The state of events and semaphores can be stored in a shared memory
+ * region, so that clients can signal and wait on them directly using
+ * futexes. The server only creates the objects, hands out the slot of an
+ * object to clients holding a handle to it, and takes part in waits that
+ * can't be done in the client (mixed object types, wait-all, alertable).
+ *
+ * Clients and the server take the signal of an object with a single atomic
+ * operation on its state, so a server-side wait is only satisfied if the
+ * server actually got the signal and not a client racing with it.
+ *
+ * Clients that change the state of an object that has server-side waiters
+ * ask the server to wake them up with the wake_fast_sync_obj request; the
+ * server_waiters count in the slot tells them when it is needed.
+ *
+ * This is only enabled when the WINEFASTSYNC environment variable is set.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "thread.h"
+#include "request.h"
+
+#define FAST_SYNC_MAX_SLOTS  65536  /* size of the shared region in slots */
+
+static int fast_sync_fd = -1;                    /* fd of the shared region */
+static struct fast_sync_slot *fast_sync_slots;   /* server mapping of the region */
+static unsigned int fast_sync_used = 1;          /* number of slots used so far, slot 0 is reserved */
+static unsigned int *fast_sync_free_list;        /* stack of freed slots */
+static unsigned int fast_sync_nb_free;           /* number of entries in the free list */
+
+#ifdef __linux__
+
+#define FUTEX_WAKE 1
+
+static inline int futex_wake( int *addr, int count )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE, count, NULL, 0, 0 );
+}
+
+#else
+
+static inline int futex_wake( int *addr, int count )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+/* create the shared region if fast synchronization is enabled */
+static int init_fast_sync(void)
+{
+    static int enabled = -1;
+    const char *env;
+    int dummy = 0;
+    void *ptr;
+
+    if (enabled != -1) return enabled;
+
+    enabled = 0;
+    if (!(env = getenv( "WINEFASTSYNC" )) || !atoi( env )) return 0;
+    if (futex_wake( &dummy, 1 ) == -1)
+    {
+        fprintf( stderr, "wineserver: futexes not supported, fast synchronization disabled\n" );
+        return 0;
+    }
+    if ((fast_sync_fd = create_temp_file( FAST_SYNC_MAX_SLOTS * sizeof(*fast_sync_slots) )) == -1)
+        return 0;
+    ptr = mmap( NULL, FAST_SYNC_MAX_SLOTS * sizeof(*fast_sync_slots),
+                PROT_READ | PROT_WRITE, MAP_SHARED, fast_sync_fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        close( fast_sync_fd );
+        fast_sync_fd = -1;
+        return 0;
+    }
+    fast_sync_slots = ptr;
+    enabled = 1;
+    if (debug_level) fprintf( stderr, "wineserver: fast synchronization enabled\n" );
+    return 1;
+}
+
+/* allocate a shared slot for an object; returns 0 if none is available */
+unsigned int alloc_fast_sync_slot( int state, unsigned int max )
+{
+    struct fast_sync_slot *slot;
+    unsigned int index;
+
+    if (!init_fast_sync()) return 0;
+
+    if (fast_sync_nb_free) index = fast_sync_free_list[--fast_sync_nb_free];
+    else if (fast_sync_used < FAST_SYNC_MAX_SLOTS) index = fast_sync_used++;
+    else return 0;
+
+    slot = &fast_sync_slots[index];
+    slot->state          = state;
+    slot->max            = max;
+    slot->server_waiters = 0;
+    slot->client_waiters = 0;
+    return index;
+}
+
+/* free the shared slot of a destroyed object */
+void free_fast_sync_slot( unsigned int index )
+{
+    unsigned int *new_list;
+
+    if (!index) return;
+    assert( index < fast_sync_used );
+
+    if (!(fast_sync_nb_free & 255))
+    {
+        new_list = realloc( fast_sync_free_list, (fast_sync_nb_free + 256) * sizeof(*new_list) );
+        if (!new_list) return;  /* leak the slot */
+        fast_sync_free_list = new_list;
+    }
+    fast_sync_free_list[fast_sync_nb_free++] = index;
+}
+
+/* retrieve the state variable of a shared slot */
+int *get_fast_sync_state( unsigned int index )
+{
+    assert( index && index < fast_sync_used );
+    return &fast_sync_slots[index].state;
+}
+
+/* wake up the client threads waiting on a shared slot */
+void wake_fast_sync_slot( unsigned int index )
+{
+    struct fast_sync_slot *slot = &fast_sync_slots[index];
+
+    if (slot->client_waiters) futex_wake( &slot->state, INT_MAX );
+}
+
+/* check if client threads are waiting on a shared slot */
+int has_fast_sync_client_waiters( unsigned int index )
+{
+    return fast_sync_slots[index].client_waiters != 0;
+}
+
+/* take the signal of a shared slot in a single atomic step, like clients do;
+ * returns 0 if the object isn't signaled, or if a client took it first */
+int acquire_fast_sync_slot( unsigned int index, enum fast_sync_type type )
+{
+    int *state = &fast_sync_slots[index].state;
+    int cur;
+
+    for (;;)
+    {
+        cur = *state;
+        switch (type)
+        {
+        case FAST_SYNC_MANUAL_EVENT:
+            return (cur & FAST_SYNC_EVENT_SIGNALED) != 0;
+        case FAST_SYNC_AUTO_EVENT:
+            if (!(cur & FAST_SYNC_EVENT_SIGNALED)) return 0;
+            if (interlocked_cmpxchg( state, cur & ~FAST_SYNC_EVENT_SIGNALED, cur ) == cur) return 1;
+            break;
+        case FAST_SYNC_SEMAPHORE:
+            if (cur <= 0) return 0;
+            if (interlocked_cmpxchg( state, cur - 1, cur ) == cur) return 1;
+            break;
+        default:
+            return 0;
+        }
+    }
+}
+
+/* give back a signal taken with acquire_fast_sync_slot */
+static void unacquire_fast_sync_slot( unsigned int index, enum fast_sync_type type )
+{
+    int *state = &fast_sync_slots[index].state;
+    int cur;
+
+    switch (type)
+    {
+    case FAST_SYNC_AUTO_EVENT:
+        do cur = *state;
+        while (interlocked_cmpxchg( state, cur | FAST_SYNC_EVENT_SIGNALED, cur ) != cur);
+        break;
+    case FAST_SYNC_SEMAPHORE:
+        interlocked_xchg_add( state, 1 );
+        break;
+    default:
+        return;
+    }
+    wake_fast_sync_slot( index );
+}
+
+/* retrieve the shared slot of an object, if it has one */
+static enum fast_sync_type get_obj_fast_sync( struct object *obj, unsigned int *index )
+{
+    enum fast_sync_type type;
+
+    if ((type = get_event_fast_sync( obj, index ))) return type;
+    return get_semaphore_fast_sync( obj, index );
+}
+
+/* take the signals of the shared objects of a wait-all whose objects all look signaled;
+ * if a client took one of them first, give back the ones already taken and return 0 */
+int acquire_fast_sync_wait_all( struct wait_queue_entry *queues, int count )
+{
+    enum fast_sync_type type;
+    unsigned int index;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(type = get_obj_fast_sync( queues[i].obj, &index ))) continue;
+        if (!acquire_fast_sync_slot( index, type )) break;
+    }
+    if (i == count) return 1;
+
+    while (i--)
+        if ((type = get_obj_fast_sync( queues[i].obj, &index ))) unacquire_fast_sync_slot( index, type );
+    return 0;
+}
+
+/* add a server-side waiter to a shared slot */
+void add_fast_sync_waiter( unsigned int index )
+{
+    /* the barrier makes sure that the state is checked after the waiter is added */
+    interlocked_xchg_add( &fast_sync_slots[index].server_waiters, 1 );
+}
+
+/* remove a server-side waiter from a shared slot */
+void remove_fast_sync_waiter( unsigned int index )
+{
+    interlocked_xchg_add( &fast_sync_slots[index].server_waiters, -1 );
+}
+
+/* get the shared region of the fast synchronization objects */
+DECL_HANDLER(get_fast_sync_region)
+{
+    if (!init_fast_sync())
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    reply->size = FAST_SYNC_MAX_SLOTS * sizeof(*fast_sync_slots);
+    send_client_fd( current->process, fast_sync_fd, 0 );
+}
+
+/* get the shared slot of an object */
+DECL_HANDLER(get_fast_sync_obj)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if ((reply->type = get_obj_fast_sync( obj, &reply->index )))
+        reply->access = get_handle_access( current->process, req->handle );
+    else
+        set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
+
+/* wake up the server-side waiters of an object signaled by a client */
+DECL_HANDLER(wake_fast_sync_obj)
+{
+    struct object *obj;
+    unsigned int index;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if (get_obj_fast_sync( obj, &index ))
+        wake_up( obj, 0 );
+    else
+        set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
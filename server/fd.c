@@ -2576,8 +2576,26 @@ DECL_HANDLER(set_completion_info)
 /* push new completion msg into a completion queue attached to the fd */
 DECL_HANDLER(add_fd_completion)
 {
-    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
-    if (fd)
+    struct fd *fd;
+    struct event *event;
+
+    if (req->event && (event = get_event_obj( current->process, req->event, EVENT_MODIFY_STATE )))
+    {
+        set_event( event );
+        release_object( event );
+    }
+    if (req->apc)
+    {
+        apc_call_t data;
+
+        memset( &data, 0, sizeof(data) );
+        data.type         = APC_USER;
+        data.user.func    = req->apc;
+        data.user.args[0] = req->apc_arg;
+        data.user.args[1] = req->iosb;
+        thread_queue_apc( NULL, current, NULL, &data );
+    }
+    if (req->cvalue && (fd = get_handle_fd_obj( current->process, req->handle, 0 )))
     {
         if (fd->completion)
             add_completion( fd->completion, fd->comp_key, req->cvalue, req->status, req->information );
@@ -45,14 +45,16 @@ struct handle_entry
     unsigned int   access;    /* access rights */
 };
 
+/* the entries are allocated in fixed-size blocks so that they never move when the table grows */
 struct handle_table
 {
-    struct object        obj;         /* object header */
-    struct process      *process;     /* process owning this table */
-    int                  count;       /* number of allocated entries */
-    int                  last;        /* last used entry */
-    int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    struct object         obj;         /* object header */
+    struct process       *process;     /* process owning this table */
+    int                   count;       /* number of allocated entries */
+    int                   last;        /* last used entry */
+    int                   free;        /* first entry that may be free */
+    int                   block_count; /* size of the blocks array */
+    struct handle_entry **blocks;      /* blocks of HANDLE_BLOCK_SIZE handle entries */
 };
 
 static struct handle_table *global_table;
@@ -63,7 +65,7 @@ static struct handle_table *global_table;
 #define RESERVED_CLOSE_PROTECT (HANDLE_FLAG_PROTECT_FROM_CLOSE << RESERVED_SHIFT)
 #define RESERVED_ALL           (RESERVED_INHERIT | RESERVED_CLOSE_PROTECT)
 
-#define MIN_HANDLE_ENTRIES  32
+#define HANDLE_BLOCK_SIZE   256
 #define MAX_HANDLE_ENTRIES  0x00ffffff
 
 
@@ -79,6 +81,12 @@ static inline int handle_to_index( obj_handle_t handle )
     return (handle >> 2) - 1;
 }
 
+/* get the entry for a given table index, which must be below table->count */
+static inline struct handle_entry *get_entry( struct handle_table *table, int index )
+{
+    return &table->blocks[index / HANDLE_BLOCK_SIZE][index % HANDLE_BLOCK_SIZE];
+}
+
 /* global handle conversion */
 
 #define HANDLE_OBFUSCATOR 0x544a4def
@@ -149,9 +157,9 @@ static void handle_table_dump( struct object *obj, int verbose )
     fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
              table->last, table->count, table->process );
     if (!verbose) return;
-    entry = table->entries;
-    for (i = 0; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         fprintf( stderr, "    %04x: %p %08x ",
                  index_to_handle(i), entry->ptr, entry->access );
@@ -172,20 +180,23 @@ static void handle_table_destroy( struct object *obj )
     /* first notify all objects that handles are being closed */
     if (table->process)
     {
-        for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+        for (i = 0; i <= table->last; i++)
         {
-            struct object *obj = entry->ptr;
+            struct object *obj = get_entry( table, i )->ptr;
             if (obj) obj->ops->close_handle( obj, table->process, index_to_handle(i) );
         }
     }
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
-        struct object *obj = entry->ptr;
+        struct object *obj;
+        entry = get_entry( table, i );
+        obj = entry->ptr;
         entry->ptr = NULL;
         if (obj) release_object_from_handle( obj );
     }
-    free( table->entries );
+    for (i = 0; i < table->count / HANDLE_BLOCK_SIZE; i++) free( table->blocks[i] );
+    free( table->blocks );
 }
 
 /* close all the process handles and free the handle table */
@@ -197,52 +208,71 @@ void close_process_handles( struct process *process )
     if (table) release_object( table );
 }
 
+/* grow a handle table by one block of entries; existing entries are not moved */
+static int grow_handle_table( struct handle_table *table )
+{
+    struct handle_entry **new_blocks, *block;
+    int nb_blocks = table->count / HANDLE_BLOCK_SIZE;
+
+    if (table->count >= MAX_HANDLE_ENTRIES) goto error;
+    if (nb_blocks == table->block_count)
+    {
+        int new_count = max( 4, table->block_count * 2 );
+        if (!(new_blocks = realloc( table->blocks, new_count * sizeof(*new_blocks) ))) goto error;
+        table->blocks      = new_blocks;
+        table->block_count = new_count;
+    }
+    if (!(block = malloc( HANDLE_BLOCK_SIZE * sizeof(*block) ))) goto error;
+    table->blocks[nb_blocks] = block;
+    table->count += HANDLE_BLOCK_SIZE;
+    return 1;
+
+error:
+    set_error( STATUS_INSUFFICIENT_RESOURCES );
+    return 0;
+}
+
 /* allocate a new handle table */
 struct handle_table *alloc_handle_table( struct process *process, int count )
 {
     struct handle_table *table;
 
-    if (count < MIN_HANDLE_ENTRIES) count = MIN_HANDLE_ENTRIES;
     if (!(table = alloc_object( &handle_table_ops )))
         return NULL;
-    table->process = process;
-    table->count   = count;
-    table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
-    release_object( table );
-    return NULL;
-}
-
-/* grow a handle table */
-static int grow_handle_table( struct handle_table *table )
-{
-    struct handle_entry *new_entries;
-    int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
-
-    if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
+    table->process     = process;
+    table->count       = 0;
+    table->last        = -1;
+    table->free        = 0;
+    table->block_count = 0;
+    table->blocks      = NULL;
+    do
     {
-        set_error( STATUS_INSUFFICIENT_RESOURCES );
-        return 0;
-    }
-    table->entries = new_entries;
-    table->count   = count;
-    return 1;
+        if (!grow_handle_table( table ))
+        {
+            release_object( table );
+            return NULL;
+        }
+    } while (table->count < count);
+    return table;
 }
 
 /* allocate the first free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
+    struct handle_entry *entry;
     int i;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
+    for (i = table->free; i <= table->last; i++)
     {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
+        entry = get_entry( table, i );
+        if (!entry->ptr) goto found;
     }
+    if (i >= MAX_HANDLE_ENTRIES || (i >= table->count && !grow_handle_table( table )))
+    {
+        set_error( STATUS_INSUFFICIENT_RESOURCES );
+        return 0;
+    }
+    entry = get_entry( table, i );
     table->last = i;
  found:
     table->free = i + 1;
@@ -326,7 +356,7 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     index = handle_to_index( handle );
     if (index < 0) return NULL;
     if (index > table->last) return NULL;
-    entry = table->entries + index;
+    entry = get_entry( table, index );
     if (!entry->ptr) return NULL;
     return entry;
 }
@@ -334,22 +364,14 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
-    struct handle_entry *entry = table->entries + table->last;
-    struct handle_entry *new_entries;
-    int count = table->count;
+    while (table->last >= 0 && !get_entry( table, table->last )->ptr) table->last--;
 
-    while (table->last >= 0)
+    /* free the unused blocks at the end, but keep a spare one */
+    while (table->count > HANDLE_BLOCK_SIZE && table->last < table->count - 2 * HANDLE_BLOCK_SIZE)
     {
-        if (entry->ptr) break;
-        table->last--;
-        entry--;
+        table->count -= HANDLE_BLOCK_SIZE;
+        free( table->blocks[table->count / HANDLE_BLOCK_SIZE] );
     }
-    if (table->last >= count / 4) return;  /* no need to shrink */
-    if (count < MIN_HANDLE_ENTRIES * 2) return;  /* too small to shrink */
-    count /= 2;
-    if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
-    table->count   = count;
-    table->entries = new_entries;
 }
 
 /* copy the handle table of the parent process */
@@ -363,19 +385,17 @@ struct handle_table *copy_handle_table( struct process *process, struct process
     assert( parent_table );
     assert( parent_table->obj.ops == &handle_table_ops );
 
-    if (!(table = alloc_handle_table( process, parent_table->count )))
+    if (!(table = alloc_handle_table( process, parent_table->last + 1 )))
         return NULL;
 
-    if ((table->last = parent_table->last) >= 0)
+    table->last = parent_table->last;
+    for (i = 0; i <= table->last; i++)
     {
-        struct handle_entry *ptr = table->entries;
-        memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-        for (i = 0; i <= table->last; i++, ptr++)
-        {
-            if (!ptr->ptr) continue;
-            if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-            else ptr->ptr = NULL; /* don't inherit this entry */
-        }
+        struct handle_entry *ptr = get_entry( table, i );
+        *ptr = *get_entry( parent_table, i );
+        if (!ptr->ptr) continue;
+        if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
+        else ptr->ptr = NULL; /* don't inherit this entry */
     }
     /* attempt to shrink the table */
     shrink_handle_table( table );
@@ -388,15 +408,25 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     struct handle_table *table;
     struct handle_entry *entry;
     struct object *obj;
+    int index;
 
     if (!(entry = get_handle( process, handle ))) return STATUS_INVALID_HANDLE;
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
     obj = entry->ptr;
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
     entry->ptr = NULL;
-    table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    if (handle_is_global(handle))
+    {
+        table = global_table;
+        index = handle_to_index( handle_global_to_local(handle) );
+    }
+    else
+    {
+        table = process->handles;
+        index = handle_to_index( handle );
+    }
+    if (index < table->free) table->free = index;
+    if (index == table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
     return STATUS_SUCCESS;
 }
@@ -476,8 +506,9 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+    for (i = 0; i <= table->last; i++)
     {
+        ptr = get_entry( table, i );
         if (!ptr->ptr) continue;
         if (ptr->ptr->ops != ops) continue;
         if (ptr->access & RESERVED_INHERIT) return index_to_handle(i);
@@ -496,8 +527,9 @@ obj_handle_t enumerate_handles( struct process *process, const struct object_ops
 
     if (!table) return 0;
 
-    for (i = *index, entry = &table->entries[i]; i <= table->last; i++, entry++)
+    for (i = *index; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (entry->ptr->ops != ops) continue;
         *index = i + 1;
@@ -794,8 +826,9 @@ static int enum_handles( struct process *process, void *user )
     if (!table)
         return 0;
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (!info->handle)
         {
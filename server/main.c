@@ -41,6 +41,7 @@
 /* command-line options */
 int debug_level = 0;
 int foreground = 0;
+int request_stats = 0;
 timeout_t master_socket_timeout = 3 * -TICKS_PER_SEC;  /* master socket timeout, default is 3 seconds */
 const char *server_argv0;
 
@@ -55,6 +56,7 @@ static void usage( FILE *fh )
     fprintf(fh, "   -h,    --help            display this help message\n");
     fprintf(fh, "   -k[n], --kill[=n]        kill the current wineserver, optionally with signal n\n");
     fprintf(fh, "   -p[n], --persistent[=n]  make server persistent, optionally for n seconds\n");
+    fprintf(fh, "   -s,    --stats           print request statistics on exit\n");
     fprintf(fh, "   -v,    --version         display version information and exit\n");
     fprintf(fh, "   -w,    --wait            wait until the current wineserver terminates\n");
     fprintf(fh, "\n");
@@ -71,6 +73,7 @@ static void parse_args( int argc, char *argv[] )
         {"help",        0, NULL, 'h'},
         {"kill",        2, NULL, 'k'},
         {"persistent",  2, NULL, 'p'},
+        {"stats",       0, NULL, 's'},
         {"version",     0, NULL, 'v'},
         {"wait",        0, NULL, 'w'},
         { NULL,         0, NULL, 0}
@@ -78,7 +81,7 @@ static void parse_args( int argc, char *argv[] )
 
     server_argv0 = argv[0];
 
-    while ((optc = getopt_long( argc, argv, "d::fhk::p::vw", long_options, NULL )) != -1)
+    while ((optc = getopt_long( argc, argv, "d::fhk::p::svw", long_options, NULL )) != -1)
     {
         switch(optc)
         {
@@ -107,6 +110,9 @@ static void parse_args( int argc, char *argv[] )
                 else
                     master_socket_timeout = TIMEOUT_INFINITE;
                 break;
+            case 's':
+                request_stats = 1;
+                break;
             case 'v':
                 fprintf( stderr, "%s\n", wine_get_build_id());
                 exit(0);
@@ -142,6 +148,7 @@ int main( int argc, char *argv[] )
     open_master_socket();
 
     if (debug_level) fprintf( stderr, "wineserver: starting (pid=%ld)\n", (long) getpid() );
+    if (request_stats) atexit( dump_request_stats );
     init_signals();
     init_directories();
     init_registry();
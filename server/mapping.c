@@ -117,6 +117,51 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* file holding a copy of a PE image with the sections stored at their virtual address */
+struct image_map
+{
+    struct object   obj;             /* object header */
+    struct file    *file;            /* temp file holding the image data */
+    dev_t           dev;             /* device of the PE file */
+    ino_t           ino;             /* inode of the PE file */
+    file_pos_t      size;            /* size of the PE file */
+    time_t          mtime;           /* modification time of the PE file */
+    long            mtime_nsec;      /* nanoseconds part of the modification time */
+    mem_size_t      map_size;        /* size of the image copy */
+    int             cached;          /* whether the image cache holds a reference */
+    struct list     entry;           /* entry in global image maps list, most recently used first */
+};
+
+/* total size of the image copies kept around when no mapping or view uses them */
+#define IMAGE_MAP_CACHE_SIZE  (64 * 1024 * 1024)
+
+static void image_map_dump( struct object *obj, int verbose );
+static void image_map_destroy( struct object *obj );
+
+static const struct object_ops image_map_ops =
+{
+    sizeof(struct image_map),  /* size */
+    image_map_dump,            /* dump */
+    no_get_type,               /* get_type */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    no_map_access,             /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_close_handle,           /* close_handle */
+    image_map_destroy          /* destroy */
+};
+
+static struct list image_map_list = LIST_INIT( image_map_list );
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -124,6 +169,7 @@ struct memory_view
     struct fd      *fd;              /* fd for mapped file */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct image_map *image_map;     /* temp file for page-aligned PE image */
     unsigned int    flags;           /* SEC_* flags */
     client_ptr_t    base;            /* view base address (in process addr space) */
     mem_size_t      size;            /* view size */
@@ -139,6 +185,7 @@ struct mapping
     pe_image_info_t image;           /* image info (for PE image mapping) */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct image_map *image_map;     /* temp file for page-aligned PE image */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -217,6 +264,22 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void image_map_dump( struct object *obj, int verbose )
+{
+    struct image_map *image = (struct image_map *)obj;
+    fprintf( stderr, "Image mapping dev=%lx ino=%lx file=%p size=%08x%08x\n",
+             (long)image->dev, (long)image->ino, image->file,
+             (unsigned int)(image->map_size >> 32), (unsigned int)image->map_size );
+}
+
+static void image_map_destroy( struct object *obj )
+{
+    struct image_map *image = (struct image_map *)obj;
+
+    release_object( image->file );
+    list_remove( &image->entry );
+}
+
 /* extend a file beyond the current end of file */
 static int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -259,7 +322,7 @@ static int check_current_dir_for_exec(void)
 }
 
 /* create a temp file for anonymous mappings */
-static int create_temp_file( file_pos_t size )
+int create_temp_file( file_pos_t size )
 {
     static int temp_dir_fd = -1;
     char tmpfn[] = "anonmap.XXXXXX";
@@ -313,6 +376,7 @@ static void free_memory_view( struct memory_view *view )
     if (view->fd) release_object( view->fd );
     if (view->committed) release_object( view->committed );
     if (view->shared) release_object( view->shared );
+    if (view->image_map) release_object( view->image_map );
     list_remove( &view->entry );
     free( view );
 }
@@ -522,6 +586,151 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     return 0;
 }
 
+static inline long get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/* keep the most recently used image copies alive once the last mapping and view
+ * using them are gone, so that the next process loading the module finds them */
+static void cache_image_map( struct image_map *image )
+{
+    struct image_map *ptr, *next;
+    mem_size_t total = 0;
+
+    list_remove( &image->entry );
+    list_add_head( &image_map_list, &image->entry );
+    if (!image->cached)
+    {
+        grab_object( image );
+        image->cached = 1;
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &image_map_list, struct image_map, entry )
+    {
+        if (!ptr->cached) continue;
+        total += ptr->map_size;
+        if (total <= IMAGE_MAP_CACHE_SIZE) continue;
+        ptr->cached = 0;
+        release_object( ptr );  /* may free it and remove it from the list */
+    }
+}
+
+/* find the page-aligned image copy for a given file */
+static struct image_map *get_image_file( const struct stat *st )
+{
+    struct image_map *ptr;
+
+    LIST_FOR_EACH_ENTRY( ptr, &image_map_list, struct image_map, entry )
+    {
+        if (ptr->dev != st->st_dev || ptr->ino != st->st_ino) continue;
+        if (ptr->size != st->st_size) continue;
+        if (ptr->mtime != st->st_mtime || ptr->mtime_nsec != get_mtime_nsec( st )) continue;
+        grab_object( ptr );
+        cache_image_map( ptr );
+        return ptr;
+    }
+    return NULL;
+}
+
+/* copy a range of a file into the temp file of an image mapping */
+static int copy_image_data( int fd, int image_fd, off_t read_pos, off_t write_pos, size_t size )
+{
+    char buffer[65536];
+
+    while (size)
+    {
+        long res = pread( fd, buffer, min( size, sizeof(buffer) ), read_pos );
+        if (!res && size < 0x200) return 1;  /* partial sector at EOF is not an error */
+        if (res <= 0) return 0;
+        if (pwrite( image_fd, buffer, res, write_pos ) != res) return 0;
+        size -= res;
+        read_pos += res;
+        write_pos += res;
+    }
+    return 1;
+}
+
+/* build a copy of the image with the sections at their virtual address, so that
+ * the client can mmap sections whose file offset is not page-aligned instead of
+ * reading them in every process */
+static void build_image_mapping( struct mapping *mapping, int fd, file_pos_t file_size,
+                                 IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
+{
+    struct image_map *image;
+    struct file *file;
+    struct stat st;
+    unsigned int i;
+    size_t map_size, sec_size, header_size;
+    off_t file_start, end;
+    int image_fd, needed = 0;
+
+    if (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) return;
+
+    end = mapping->image.header_size;
+    for (i = 0; i < nb_sec; i++)
+    {
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) &&
+            (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE)) continue;
+        get_section_sizes( &sec[i], &map_size, &file_start, &sec_size );
+        /* leave images with overlapping or out of range sections to the client */
+        if (sec[i].VirtualAddress < end) return;
+        end = sec[i].VirtualAddress + map_size;
+        if (end > mapping->image.map_size || end < sec[i].VirtualAddress) return;
+        if (!sec[i].PointerToRawData || !sec_size) continue;
+        if (sec[i].PointerToRawData >= file_size || file_start + sec_size > ((file_size + 0x1ff) & ~0x1ff))
+            return;
+        if (file_start & page_mask) needed = 1;
+    }
+    if (!needed) return;  /* all sections can be mapped from the file */
+
+    if (fstat( fd, &st ) == -1) return;
+    if ((mapping->image_map = get_image_file( &st ))) return;
+
+    if ((image_fd = create_temp_file( mapping->image.map_size )) == -1 ||
+        !(file = create_file_for_fd( image_fd, FILE_GENERIC_READ, 0 )))
+    {
+        clear_error();
+        return;
+    }
+
+    header_size = min( mapping->image.header_size, file_size );
+    if (!copy_image_data( fd, image_fd, 0, 0, header_size )) goto error;
+
+    for (i = 0; i < nb_sec; i++)
+    {
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) &&
+            (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE)) continue;
+        get_section_sizes( &sec[i], &map_size, &file_start, &sec_size );
+        if (!sec[i].PointerToRawData || !sec_size) continue;
+        if (!copy_image_data( fd, image_fd, file_start, sec[i].VirtualAddress, sec_size )) goto error;
+    }
+
+    if (!(image = alloc_object( &image_map_ops ))) goto error;
+    image->file       = file;
+    image->dev        = st.st_dev;
+    image->ino        = st.st_ino;
+    image->size       = st.st_size;
+    image->mtime      = st.st_mtime;
+    image->mtime_nsec = get_mtime_nsec( &st );
+    image->map_size   = mapping->image.map_size;
+    image->cached     = 0;
+    list_add_head( &image_map_list, &image->entry );
+    cache_image_map( image );
+    mapping->image_map = image;
+    return;
+
+ error:
+    release_object( file );
+    clear_error();
+}
+
 /* load the CLR header from its section */
 static int load_clr_header( IMAGE_COR20_HEADER *hdr, size_t va, size_t size, int unix_fd,
                             IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
@@ -710,6 +919,8 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
     if (!build_shared_mapping( mapping, unix_fd, sec, nt.FileHeader.NumberOfSections ))
         return STATUS_INVALID_FILE_FOR_SECTION;
 
+    build_image_mapping( mapping, unix_fd, file_size, sec, nt.FileHeader.NumberOfSections );
+
     return STATUS_SUCCESS;
 }
 
@@ -771,6 +982,7 @@ static struct object *create_mapping( struct object *root, const struct unicode_
     mapping->size        = size;
     mapping->fd          = NULL;
     mapping->shared      = NULL;
+    mapping->image_map   = NULL;
     mapping->committed   = NULL;
 
     if (!(mapping->flags = get_mapping_flags( handle, flags ))) goto error;
@@ -901,6 +1113,7 @@ static void mapping_destroy( struct object *obj )
     if (mapping->fd) release_object( mapping->fd );
     if (mapping->committed) release_object( mapping->committed );
     if (mapping->shared) release_object( mapping->shared );
+    if (mapping->image_map) release_object( mapping->image_map );
 }
 
 static enum server_fd_type mapping_get_fd_type( struct fd *fd )
@@ -969,6 +1182,8 @@ DECL_HANDLER(get_mapping_info)
     if (mapping->shared)
         reply->shared_file = alloc_handle( current->process, mapping->shared->file,
                                            GENERIC_READ|GENERIC_WRITE, 0 );
+    if (mapping->image_map)
+        reply->image_file = alloc_handle( current->process, mapping->image_map->file, GENERIC_READ, 0 );
     release_object( mapping );
 }
 
@@ -1020,6 +1235,7 @@ DECL_HANDLER(map_view)
         view->fd        = !is_fd_removable( mapping->fd ) ? (struct fd *)grab_object( mapping->fd ) : NULL;
         view->committed = mapping->committed ? (struct ranges *)grab_object( mapping->committed ) : NULL;
         view->shared    = mapping->shared ? (struct shared_map *)grab_object( mapping->shared ) : NULL;
+        view->image_map = mapping->image_map ? (struct image_map *)grab_object( mapping->image_map ) : NULL;
         list_add_tail( &current->process->views, &view->entry );
     }
 
@@ -46,9 +46,15 @@
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the table */
+    struct list        *names;           /* array of hash entry lists */
 };
 
+/* name lookup statistics, printed with the request statistics */
+static unsigned int lookup_count;        /* number of name lookups */
+static unsigned long long lookup_chain;  /* total number of names compared in lookups */
+static unsigned int lookup_max_chain;    /* longest hash chain walked by a lookup */
+
 
 #ifdef DEBUG_OBJECTS
 static struct list object_list = LIST_INIT(object_list);
@@ -127,19 +133,44 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
-static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+static inline unsigned int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
 {
-    WCHAR hash = 0;
-    len /= sizeof(WCHAR);
-    while (len--) hash ^= tolowerW(*name++);
-    return hash % namespace->hash_size;
+    return hash_strW( name, len ) % namespace->hash_size;
+}
+
+/* grow the hash table of a namespace, moving all the names to the new lists */
+static void grow_namespace( struct namespace *namespace )
+{
+    unsigned int i, hash, new_size = namespace->hash_size * 4 + 1;
+    struct list *new_names, *old_names = namespace->names;
+    struct object_name *ptr, *next;
+
+    if (!(new_names = malloc( new_size * sizeof(*new_names) ))) return;  /* keep the old table */
+    for (i = 0; i < new_size; i++) list_init( &new_names[i] );
+
+    namespace->names = new_names;
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &old_names[i], struct object_name, entry )
+        {
+            hash = hash_strW( ptr->name, ptr->len ) % new_size;
+            list_remove( &ptr->entry );
+            list_add_tail( &new_names[hash], &ptr->entry );
+        }
+    }
+    namespace->hash_size = new_size;
+    free( old_names );
 }
 
 void namespace_add( struct namespace *namespace, struct object_name *ptr )
 {
-    int hash = get_name_hash( namespace, ptr->name, ptr->len );
+    int hash;
 
+    if (namespace->count >= 2 * namespace->hash_size) grow_namespace( namespace );
+    hash = get_name_hash( namespace, ptr->name, ptr->len );
     list_add_head( &namespace->names[hash], &ptr->entry );
+    ptr->namespace = namespace;
+    namespace->count++;
 }
 
 /* allocate a name for an object */
@@ -151,6 +182,7 @@ static struct object_name *alloc_name( const struct unicode_str *name )
     {
         ptr->len = name->len;
         ptr->parent = NULL;
+        ptr->namespace = NULL;
         memcpy( ptr->name, name->str, name->len );
     }
     return ptr;
@@ -437,6 +469,8 @@ struct object *find_object( const struct namespace *namespace, const struct unic
 {
     const struct list *list;
     struct list *p;
+    struct object *obj = NULL;
+    unsigned int chain = 0;
 
     if (!name || !name->len) return NULL;
 
@@ -444,19 +478,23 @@ struct object *find_object( const struct namespace *namespace, const struct unic
     LIST_FOR_EACH( p, list )
     {
         const struct object_name *ptr = LIST_ENTRY( p, struct object_name, entry );
+        chain++;
         if (ptr->len != name->len) continue;
         if (attributes & OBJ_CASE_INSENSITIVE)
         {
-            if (!strncmpiW( ptr->name, name->str, name->len/sizeof(WCHAR) ))
-                return grab_object( ptr->obj );
+            if (strncmpiW( ptr->name, name->str, name->len/sizeof(WCHAR) )) continue;
         }
         else
         {
-            if (!memcmp( ptr->name, name->str, name->len ))
-                return grab_object( ptr->obj );
+            if (memcmp( ptr->name, name->str, name->len )) continue;
         }
+        obj = grab_object( ptr->obj );
+        break;
     }
-    return NULL;
+    lookup_count++;
+    lookup_chain += chain;
+    if (chain > lookup_max_chain) lookup_max_chain = chain;
+    return obj;
 }
 
 /* find an object by its index; the refcount is incremented */
@@ -483,15 +521,34 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!hash_size) hash_size = 1;
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size = hash_size;
+    namespace->count     = 0;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
     return namespace;
 }
 
+/* free a namespace; it must not contain any names */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    free( namespace->names );
+    free( namespace );
+}
+
+/* print the name lookup statistics */
+void dump_namespace_stats(void)
+{
+    fprintf( stderr, "wineserver: %u name lookups, %.2f names compared per lookup, longest chain %u\n",
+             lookup_count, lookup_count ? (double)lookup_chain / lookup_count : 0.0, lookup_max_chain );
+}
+
 /* functions for unimplemented/default object operations */
 
 struct object_type *no_get_type( struct object *obj )
@@ -683,6 +740,7 @@ int no_link_name( struct object *obj, struct object_name *name, struct object *p
 void default_unlink_name( struct object *obj, struct object_name *name )
 {
     list_remove( &name->entry );
+    if (name->namespace) name->namespace->count--;
 }
 
 struct object *no_open_file( struct object *obj, unsigned int access, unsigned int sharing,
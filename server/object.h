@@ -113,6 +113,7 @@ struct object_name
     struct list         entry;           /* entry in the hash list */
     struct object      *obj;             /* object owning this name */
     struct object      *parent;          /* parent object */
+    struct namespace   *namespace;       /* namespace containing the name */
     data_size_t         len;             /* name length in bytes */
     WCHAR               name[1];
 };
@@ -141,6 +142,8 @@ extern void *open_named_object( struct object *parent, const struct object_ops *
 extern void unlink_named_object( struct object *obj );
 extern void make_object_static( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
+extern void dump_namespace_stats(void);
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
 extern struct object *grab_object( void *obj );
@@ -185,6 +188,23 @@ extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_han
 extern void pulse_event( struct event *event );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern enum fast_sync_type get_event_fast_sync( struct object *obj, unsigned int *index );
+
+/* semaphore functions */
+
+extern enum fast_sync_type get_semaphore_fast_sync( struct object *obj, unsigned int *index );
+
+/* fast synchronization functions */
+
+extern unsigned int alloc_fast_sync_slot( int state, unsigned int max );
+extern void free_fast_sync_slot( unsigned int index );
+extern int *get_fast_sync_state( unsigned int index );
+extern void wake_fast_sync_slot( unsigned int index );
+extern void add_fast_sync_waiter( unsigned int index );
+extern void remove_fast_sync_waiter( unsigned int index );
+extern int has_fast_sync_client_waiters( unsigned int index );
+extern int acquire_fast_sync_slot( unsigned int index, enum fast_sync_type type );
+extern int acquire_fast_sync_wait_all( struct wait_queue_entry *queues, int count );
 
 /* mutex functions */
 
@@ -244,6 +264,7 @@ extern struct object *create_obj_symlink( struct object *root, const struct unic
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int request_stats;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
@@ -826,21 +826,30 @@ struct region *xor_region( struct region *dst, const struct region *src1,
     return dst;
 }
 
-/* check if the given point is inside the region */
-int point_in_region( struct region *region, int x, int y )
+/* find the first rectangle that is not entirely above or to the left of the given point */
+static const rectangle_t *find_rect( const struct region *region, int x, int y )
 {
-    const rectangle_t *ptr, *end;
+    const rectangle_t *rects = region->rects;
+    int start = 0, end = region->num_rects, i;
 
-    for (ptr = region->rects, end = region->rects + region->num_rects; ptr < end; ptr++)
+    /* rectangles are y-x banded, so this condition is monotonic over the array */
+    while (start < end)
     {
-        if (ptr->top > y) return 0;
-        if (ptr->bottom <= y) continue;
-        /* now we are in the correct band */
-        if (ptr->left > x) return 0;
-        if (ptr->right <= x) continue;
-        return 1;
+        i = (start + end) / 2;
+        if (rects[i].bottom <= y || (rects[i].top <= y && rects[i].right <= x)) start = i + 1;
+        else end = i;
     }
-    return 0;
+    return rects + start;
+}
+
+/* check if the given point is inside the region */
+int point_in_region( struct region *region, int x, int y )
+{
+    const rectangle_t *ptr;
+
+    if (!region->num_rects || !point_in_rect( &region->extents, x, y )) return 0;
+    ptr = find_rect( region, x, y );
+    return (ptr < region->rects + region->num_rects && ptr->top <= y && ptr->left <= x);
 }
 
 /* check if the given rectangle is (at least partially) inside the region */
@@ -848,7 +857,9 @@ int rect_in_region( struct region *region, const rectangle_t *rect )
 {
     const rectangle_t *ptr, *end;
 
-    for (ptr = region->rects, end = region->rects + region->num_rects; ptr < end; ptr++)
+    if (!region->num_rects || !EXTENTCHECK( &region->extents, rect )) return 0;
+
+    for (ptr = find_rect( region, rect->left, rect->top ), end = region->rects + region->num_rects; ptr < end; ptr++)
     {
         if (ptr->top >= rect->bottom) return 0;
         if (ptr->bottom <= rect->top) continue;
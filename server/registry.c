@@ -35,6 +35,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -60,6 +63,21 @@ struct notify
     struct process   *process;  /* process in which the hkey is valid */
 };
 
+/* hash index of the subkey or value names of a key, for faster lookups in
+ * large keys; new entries are then appended to the arrays, which are only
+ * sorted again when they need to be enumerated */
+struct name_index_slot
+{
+    unsigned int      hash;     /* case-insensitive hash of the name */
+    int               pos;      /* position in the subkeys or values array, -1 if free */
+};
+
+struct name_index
+{
+    unsigned int      size;     /* number of slots, a power of 2 */
+    struct name_index_slot slots[1];
+};
+
 /* a registry key */
 struct key
 {
@@ -72,9 +90,11 @@ struct key
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
     struct key      **subkeys;     /* subkeys array */
+    struct name_index *subkey_index; /* hash index of subkey names (for large keys) */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
     struct key_value *values;      /* values array */
+    struct name_index *value_index; /* hash index of value names (for large keys) */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
@@ -87,6 +107,8 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOW64    0x0010  /* key contains a Wow6432Node subkey */
 #define KEY_WOWSHARE 0x0020  /* key is a Wow64 shared key (used for Software\Classes) */
+#define KEY_UNSORTED_SUBKEYS 0x0040  /* indexed subkeys array needs to be sorted */
+#define KEY_UNSORTED_VALUES  0x0080  /* indexed values array needs to be sorted */
 
 /* a key value */
 struct key_value
@@ -100,6 +122,7 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED  32  /* min. number of subkeys or values to create a hash index */
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -110,6 +133,9 @@ static struct key *root_key;
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
+static unsigned int registry_generation_value;   /* generation counter before it gets mapped */
+static unsigned int *registry_generation = &registry_generation_value;  /* shared generation counter */
+static int registry_generation_fd = -1;          /* fd of the shared generation counter */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
 
 static const WCHAR root_name[] = { '\\','R','e','g','i','s','t','r','y','\\' };
@@ -119,6 +145,8 @@ static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_va
 
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static void sort_subkeys( struct key *key );
+static void sort_values( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
@@ -204,6 +232,10 @@ static void dump_path( const struct key *key, const struct key *base, FILE *f )
 /* dump a value to a text file */
 static void dump_value( const struct key_value *value, FILE *f )
 {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *data = value->data;
+    char buffer[256];
+    char *pos = buffer;
     unsigned int i, dw;
     int count;
 
@@ -241,26 +273,37 @@ static void dump_value( const struct key_value *value, FILE *f )
     else count += fprintf( f, "hex(%x):", value->type );
     for (i = 0; i < value->len; i++)
     {
-        count += fprintf( f, "%02x", *((unsigned char *)value->data + i) );
+        if (pos > buffer + sizeof(buffer) - 8)
+        {
+            fwrite( buffer, pos - buffer, 1, f );
+            pos = buffer;
+        }
+        *pos++ = hex[data[i] >> 4];
+        *pos++ = hex[data[i] & 0x0f];
+        count += 2;
         if (i < value->len-1)
         {
-            fputc( ',', f );
+            *pos++ = ',';
             if (++count > 76)
             {
-                fprintf( f, "\\\n  " );
+                memcpy( pos, "\\\n  ", 4 );
+                pos += 4;
                 count = 2;
             }
         }
     }
-    fputc( '\n', f );
+    *pos++ = '\n';
+    fwrite( buffer, pos - buffer, 1, f );
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -418,12 +461,14 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free( key->value_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_index );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -487,9 +532,11 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->last_subkey = -1;
         key->nb_subkeys  = 0;
         key->subkeys     = NULL;
+        key->subkey_index = NULL;
         key->nb_values   = 0;
         key->last_value  = -1;
         key->values      = NULL;
+        key->value_index = NULL;
         key->modif       = modif;
         key->parent      = NULL;
         list_init( &key->notify_list );
@@ -537,6 +584,12 @@ static void check_notify( struct key *key, unsigned int change, int not_subtree
     }
 }
 
+/* invalidate the values cached by the clients */
+static inline void registry_changed(void)
+{
+    (*registry_generation)++;
+}
+
 /* update key modification time */
 static void touch_key( struct key *key, unsigned int change )
 {
@@ -544,6 +597,7 @@ static void touch_key( struct key *key, unsigned int change )
 
     key->modif = current_time;
     make_dirty( key );
+    registry_changed();
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -551,6 +605,132 @@ static void touch_key( struct key *key, unsigned int change )
         check_notify( k, change, 0 );
 }
 
+/* allocate an empty name index with room for count entries */
+static struct name_index *alloc_name_index( int count )
+{
+    struct name_index *index;
+    unsigned int i, size = 2 * MIN_INDEXED;
+
+    while (size < 2 * count) size *= 2;  /* keep the load factor below 1/2 */
+    if (!(index = malloc( offsetof( struct name_index, slots[size] )))) return NULL;
+    index->size = size;
+    for (i = 0; i < size; i++) index->slots[i].pos = -1;
+    return index;
+}
+
+/* add an entry to a name index; there must be a free slot */
+static void add_name_index_entry( struct name_index *index, unsigned int hash, int pos )
+{
+    unsigned int i, mask = index->size - 1;
+
+    for (i = hash & mask; index->slots[i].pos != -1; i = (i + 1) & mask);
+    index->slots[i].hash = hash;
+    index->slots[i].pos  = pos;
+}
+
+/* remove the entry for a given array position from a name index */
+static void remove_name_index_entry( struct name_index *index, unsigned int hash, int pos )
+{
+    unsigned int i, j, home, mask = index->size - 1;
+
+    for (i = hash & mask; index->slots[i].pos != pos; i = (i + 1) & mask)
+        assert( index->slots[i].pos != -1 );
+
+    /* move back the following entries of the probe sequence to fill the hole */
+    for (j = i;;)
+    {
+        index->slots[i].pos = -1;
+        for (;;)
+        {
+            j = (j + 1) & mask;
+            if (index->slots[j].pos == -1) return;
+            home = index->slots[j].hash & mask;
+            if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) break;
+        }
+        index->slots[i] = index->slots[j];
+        i = j;
+    }
+}
+
+/* update the positions of a name index after an array insertion or removal */
+static void shift_name_index( struct name_index *index, int pos, int delta )
+{
+    unsigned int i;
+
+    for (i = 0; i < index->size; i++) if (index->slots[i].pos >= pos) index->slots[i].pos += delta;
+}
+
+/* (re)build the hash index of the subkeys of a key */
+static void build_subkey_index( struct key *key )
+{
+    int i;
+
+    free( key->subkey_index );
+    if (!(key->subkey_index = alloc_name_index( key->last_subkey + 1 )))
+    {
+        sort_subkeys( key );  /* lookups will use a binary search */
+        return;
+    }
+    for (i = 0; i <= key->last_subkey; i++)
+        add_name_index_entry( key->subkey_index,
+                              hash_strW( key->subkeys[i]->name, key->subkeys[i]->namelen ), i );
+}
+
+/* (re)build the hash index of the values of a key */
+static void build_value_index( struct key *key )
+{
+    int i;
+
+    free( key->value_index );
+    if (!(key->value_index = alloc_name_index( key->last_value + 1 )))
+    {
+        sort_values( key );  /* lookups will use a binary search */
+        return;
+    }
+    for (i = 0; i <= key->last_value; i++)
+        add_name_index_entry( key->value_index,
+                              hash_strW( key->values[i].name, key->values[i].namelen ), i );
+}
+
+/* compare two subkey or value names, using the sort order of the arrays */
+static int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmpW( name1, name2, min( len1, len2 ) / sizeof(WCHAR) );
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(const struct key * const *)p1;
+    const struct key *key2 = *(const struct key * const *)p2;
+    return compare_names( key1->name, key1->namelen, key2->name, key2->namelen );
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1, *value2 = p2;
+    return compare_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* sort the subkeys of a key that were appended out of order */
+static void sort_subkeys( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_SUBKEYS)) return;
+    qsort( key->subkeys, key->last_subkey + 1, sizeof(*key->subkeys), compare_subkeys );
+    key->flags &= ~KEY_UNSORTED_SUBKEYS;
+    build_subkey_index( key );
+}
+
+/* sort the values of a key that were appended out of order */
+static void sort_values( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_VALUES)) return;
+    qsort( key->values, key->last_value + 1, sizeof(*key->values), compare_values );
+    key->flags &= ~KEY_UNSORTED_VALUES;
+    build_value_index( key );
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct key *key )
 {
@@ -599,6 +779,15 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
         for (i = ++parent->last_subkey; i > index; i--)
             parent->subkeys[i] = parent->subkeys[i-1];
         parent->subkeys[index] = key;
+        if (parent->subkey_index && index && index == parent->last_subkey &&
+            compare_subkeys( &parent->subkeys[index - 1], &key ) > 0)
+            parent->flags |= KEY_UNSORTED_SUBKEYS;
+        if (parent->subkey_index && 2 * (parent->last_subkey + 1) <= parent->subkey_index->size)
+        {
+            if (index < parent->last_subkey) shift_name_index( parent->subkey_index, index, 1 );
+            add_name_index_entry( parent->subkey_index, hash_strW( key->name, key->namelen ), index );
+        }
+        else if (parent->last_subkey + 1 >= MIN_INDEXED) build_subkey_index( parent );
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
     }
@@ -615,6 +804,11 @@ static void free_subkey( struct key *parent, int index )
     assert( index <= parent->last_subkey );
 
     key = parent->subkeys[index];
+    if (parent->subkey_index)
+    {
+        remove_name_index_entry( parent->subkey_index, hash_strW( key->name, key->namelen ), index );
+        shift_name_index( parent->subkey_index, index + 1, -1 );
+    }
     for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
     key->flags |= KEY_DELETED;
@@ -641,6 +835,23 @@ static struct key *find_subkey( const struct key *key, const struct unicode_str
     int i, min, max, res;
     data_size_t len;
 
+    if (key->subkey_index)
+    {
+        const struct name_index *idx = key->subkey_index;
+        unsigned int slot, hash = hash_strW( name->str, name->len ), mask = idx->size - 1;
+
+        for (slot = hash & mask; (i = idx->slots[slot].pos) != -1; slot = (slot + 1) & mask)
+        {
+            if (idx->slots[slot].hash != hash || key->subkeys[i]->namelen != name->len) continue;
+            if (memicmpW( key->subkeys[i]->name, name->str, name->len / sizeof(WCHAR) )) continue;
+            *index = i;
+            return key->subkeys[i];
+        }
+        /* not found, new subkeys are appended to indexed keys */
+        *index = key->last_subkey + 1;
+        return NULL;
+    }
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -877,7 +1088,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     static const WCHAR backslash[] = { '\\' };
@@ -895,6 +1106,7 @@ static void enum_key( const struct key *key, int index, int info_class,
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -986,7 +1198,8 @@ static void enum_key( const struct key *key, int index, int info_class,
 static int delete_key( struct key *key, int recurse )
 {
     int index;
-    struct key *parent = key->parent;
+    struct key *parent = key->parent, *subkey;
+    struct unicode_str name;
 
     /* must find parent and index */
     if (key == root_key)
@@ -1000,9 +1213,10 @@ static int delete_key( struct key *key, int recurse )
         if (0 > delete_key(key->subkeys[key->last_subkey], 1))
             return -1;
 
-    for (index = 0; index <= parent->last_subkey; index++)
-        if (parent->subkeys[index] == key) break;
-    assert( index <= parent->last_subkey );
+    name.str = key->name;
+    name.len = key->namelen;
+    subkey = find_subkey( parent, &name, &index );
+    assert( subkey == key );
 
     /* we can only delete a key that has no subkeys */
     if (key->last_subkey >= 0)
@@ -1048,6 +1262,23 @@ static struct key_value *find_value( const struct key *key, const struct unicode
     int i, min, max, res;
     data_size_t len;
 
+    if (key->value_index)
+    {
+        const struct name_index *idx = key->value_index;
+        unsigned int slot, hash = hash_strW( name->str, name->len ), mask = idx->size - 1;
+
+        for (slot = hash & mask; (i = idx->slots[slot].pos) != -1; slot = (slot + 1) & mask)
+        {
+            if (idx->slots[slot].hash != hash || key->values[i].namelen != name->len) continue;
+            if (memicmpW( key->values[i].name, name->str, name->len / sizeof(WCHAR) )) continue;
+            *index = i;
+            return &key->values[i];
+        }
+        /* not found, new values are appended to indexed keys */
+        *index = key->last_value + 1;
+        return NULL;
+    }
+
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1091,6 +1322,15 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    if (key->value_index && index && index == key->last_value &&
+        compare_values( &key->values[index - 1], value ) > 0)
+        key->flags |= KEY_UNSORTED_VALUES;
+    if (key->value_index && 2 * (key->last_value + 1) <= key->value_index->size)
+    {
+        if (index < key->last_value) shift_name_index( key->value_index, index, 1 );
+        add_name_index_entry( key->value_index, hash_strW( name->str, name->len ), index );
+    }
+    else if (key->last_value + 1 >= MIN_INDEXED) build_value_index( key );
     return value;
 }
 
@@ -1173,6 +1413,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         void *data;
         data_size_t namelen, maxlen;
 
+        sort_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1225,6 +1466,11 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    if (key->value_index)
+    {
+        remove_name_index_entry( key->value_index, hash_strW( value->name, value->namelen ), index );
+        shift_name_index( key->value_index, index + 1, -1 );
+    }
     free( value->name );
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
@@ -1360,6 +1606,7 @@ static struct key *load_key( struct key *base, const char *buffer, int prefix_le
                              struct file_load_info *info, timeout_t *modif )
 {
     WCHAR *p;
+    const char *str;
     struct unicode_str name;
     int res;
     unsigned int mod;
@@ -1373,8 +1620,13 @@ static struct key *load_key( struct key *base, const char *buffer, int prefix_le
         file_read_error( "Malformed key", info );
         return NULL;
     }
-    if (sscanf( buffer + res, " %u", &mod ) == 1)
+    str = buffer + res;
+    while (isspace(*str)) str++;
+    if (isdigit(*str))
+    {
+        mod = strtoul( str, NULL, 10 );
         *modif = (timeout_t)mod * TICKS_PER_SEC + ticks_1601_to_1970;
+    }
     else
         *modif = current_time;
 
@@ -1474,15 +1726,20 @@ static int parse_hex( unsigned char *dest, data_size_t *len, const char *buffer
 {
     const char *p = buffer;
     data_size_t count = 0;
-    char *end;
 
     while (isxdigit(*p))
     {
-        unsigned int val = strtoul( p, &end, 16 );
-        if (end == p || val > 0xff) return -1;
+        unsigned int val = 0;
+
+        /* this is called for every byte of binary data, so avoid strtoul */
+        do
+        {
+            if (*p <= '9') val = (val << 4) | (*p - '0');
+            else val = (val << 4) | ((*p | 0x20) - 'a' + 10);
+            if (val > 0xff) return -1;
+        } while (isxdigit(*++p));
         if (count++ >= *len) return -1;  /* dest buffer overflow */
         *dest++ = val;
-        p = end;
         while (isspace(*p)) p++;
         if (*p == ',') p++;
         while (isspace(*p)) p++;
@@ -2222,6 +2479,7 @@ DECL_HANDLER(load_registry)
         if ((key = create_key( parent, &name, NULL, 0, KEY_WOW64_64KEY, 0, sd, &dummy )))
         {
             load_registry( key, req->file );
+            registry_changed();
             release_object( key );
         }
         release_object( parent );
@@ -2308,3 +2566,27 @@ DECL_HANDLER(set_registry_notification)
         release_object( key );
     }
 }
+
+/* get the shared registry generation counter */
+DECL_HANDLER(get_registry_generation)
+{
+    void *ptr;
+
+    if (registry_generation_fd == -1)
+    {
+        if ((registry_generation_fd = create_temp_file( sizeof(*registry_generation) )) == -1) return;
+        ptr = mmap( NULL, sizeof(*registry_generation), PROT_READ | PROT_WRITE, MAP_SHARED,
+                    registry_generation_fd, 0 );
+        if (ptr == MAP_FAILED)
+        {
+            file_set_error();
+            close( registry_generation_fd );
+            registry_generation_fd = -1;
+            return;
+        }
+        registry_generation = ptr;
+        *registry_generation = registry_generation_value;
+    }
+    reply->size = sizeof(*registry_generation);
+    send_client_fd( current->process, registry_generation_fd, 0 );
+}
@@ -286,11 +286,104 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* per-request statistics, collected with the --stats option */
+
+#define REQ_STATS_BUCKETS 20  /* log2 histogram buckets, in units of 1024ns */
+
+struct req_stats
+{
+    unsigned int       count;   /* number of calls */
+    unsigned long long time;    /* total time spent in the handler, in nanoseconds */
+    unsigned long long max;     /* longest time spent in the handler */
+    unsigned int       histogram[REQ_STATS_BUCKETS];
+};
+
+static struct req_stats req_stats[REQ_NB_REQUESTS];
+
+/* get a monotonic time stamp in nanoseconds for the request statistics */
+static unsigned long long get_stats_time(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+
+    if (!timebase.denom) mach_timebase_info( &timebase );
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif defined(HAVE_CLOCK_GETTIME)
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return 0;
+}
+
+/* account for a call to a request handler */
+static void add_req_stats( enum request req, unsigned long long time )
+{
+    struct req_stats *stats = &req_stats[req];
+    unsigned long long units = time >> 10;
+    unsigned int bucket = 0;
+
+    /* bucket 0 is for calls shorter than 1024ns, bucket n for [2^(n-1), 2^n) units */
+    while (units && bucket < REQ_STATS_BUCKETS - 1)
+    {
+        units >>= 1;
+        bucket++;
+    }
+    stats->count++;
+    stats->time += time;
+    if (time > stats->max) stats->max = time;
+    stats->histogram[bucket]++;
+}
+
+static int compare_req_stats( const void *a, const void *b )
+{
+    const struct req_stats *stats1 = &req_stats[*(const enum request *)a];
+    const struct req_stats *stats2 = &req_stats[*(const enum request *)b];
+
+    if (stats1->time != stats2->time) return stats1->time > stats2->time ? -1 : 1;
+    if (stats1->count != stats2->count) return stats1->count > stats2->count ? -1 : 1;
+    return 0;
+}
+
+/* print the request statistics, sorted by total time; the format is parsed by tools/server_stats */
+void dump_request_stats(void)
+{
+    enum request order[REQ_NB_REQUESTS];
+    unsigned long long total_time = 0;
+    unsigned int i, j, total_count = 0;
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        order[i] = i;
+        total_count += req_stats[i].count;
+        total_time += req_stats[i].time;
+    }
+    qsort( order, REQ_NB_REQUESTS, sizeof(order[0]), compare_req_stats );
+
+    fprintf( stderr, "wineserver: %u requests, %llu us total\n", total_count, total_time / 1000 );
+    fprintf( stderr, "%-32s %10s %12s %10s %10s %6s | histogram (log2 of 1024ns units)\n",
+             "request", "count", "total (us)", "avg (ns)", "max (ns)", "%time" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct req_stats *stats = &req_stats[order[i]];
+
+        if (!stats->count) break;
+        fprintf( stderr, "%-32s %10u %12llu %10llu %10llu %5.1f%% |", get_req_name( order[i] ),
+                 stats->count, stats->time / 1000, stats->time / stats->count, stats->max,
+                 total_time ? stats->time * 100.0 / total_time : 0.0 );
+        for (j = 0; j < REQ_STATS_BUCKETS; j++) fprintf( stderr, " %u", stats->histogram[j] );
+        fputc( '\n', stderr );
+    }
+    dump_namespace_stats();
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    unsigned long long start;
 
     current = thread;
     current->reply_size = 0;
@@ -300,7 +393,15 @@ static void call_req_handler( struct thread *thread )
     if (debug_level) trace_request();
 
     if (req < REQ_NB_REQUESTS)
-        req_handlers[req]( &current->req, &reply );
+    {
+        if (request_stats)
+        {
+            start = get_stats_time();
+            req_handlers[req]( &current->req, &reply );
+            add_req_stats( req, get_stats_time() - start );
+        }
+        else req_handlers[req]( &current->req, &reply );
+    }
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
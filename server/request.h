@@ -62,6 +62,8 @@ extern int wait_for_lock(void);
 extern int kill_lock_owner( int sig );
 extern int server_dir_fd, config_dir_fd;
 
+extern void dump_request_stats(void);
+extern const char *get_req_name( enum request req );
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
 
@@ -153,6 +155,9 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_fast_sync_region);
+DECL_HANDLER(get_fast_sync_obj);
+DECL_HANDLER(wake_fast_sync_obj);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -228,6 +233,7 @@ DECL_HANDLER(load_registry);
 DECL_HANDLER(unload_registry);
 DECL_HANDLER(save_registry);
 DECL_HANDLER(set_registry_notification);
+DECL_HANDLER(get_registry_generation);
 DECL_HANDLER(create_timer);
 DECL_HANDLER(open_timer);
 DECL_HANDLER(set_timer);
@@ -381,6 +387,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -448,6 +455,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_fast_sync_region,
+    (req_handler)req_get_fast_sync_obj,
+    (req_handler)req_wake_fast_sync_obj,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -523,6 +533,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_unload_registry,
     (req_handler)req_save_registry,
     (req_handler)req_set_registry_notification,
+    (req_handler)req_get_registry_generation,
     (req_handler)req_create_timer,
     (req_handler)req_open_timer,
     (req_handler)req_set_timer,
@@ -676,6 +687,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -993,6 +1005,17 @@ C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_region_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_region_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_fast_sync_region_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_obj_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fast_sync_obj_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_obj_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_obj_reply, type) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_obj_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_obj_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct wake_fast_sync_obj_request, handle) == 12 );
+C_ASSERT( sizeof(struct wake_fast_sync_obj_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, create) == 20 );
@@ -1280,7 +1303,8 @@ C_ASSERT( sizeof(struct get_mapping_info_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, size) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, flags) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, shared_file) == 20 );
-C_ASSERT( sizeof(struct get_mapping_info_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, image_file) == 24 );
+C_ASSERT( sizeof(struct get_mapping_info_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, mapping) == 12 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, base) == 24 );
@@ -1426,6 +1450,9 @@ C_ASSERT( FIELD_OFFSET(struct set_registry_notification_request, event) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_registry_notification_request, subtree) == 20 );
 C_ASSERT( FIELD_OFFSET(struct set_registry_notification_request, filter) == 24 );
 C_ASSERT( sizeof(struct set_registry_notification_request) == 32 );
+C_ASSERT( sizeof(struct get_registry_generation_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_registry_generation_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_registry_generation_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_timer_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_timer_request, manual) == 16 );
 C_ASSERT( sizeof(struct create_timer_request) == 24 );
@@ -2317,6 +2344,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2329,7 +2359,11 @@ C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, status) == 32 );
-C_ASSERT( sizeof(struct add_fd_completion_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, event) == 36 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, apc) == 40 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, apc_arg) == 48 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, iosb) == 56 );
+C_ASSERT( sizeof(struct add_fd_completion_request) == 64 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_disp_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_disp_info_request, unlink) == 16 );
 C_ASSERT( sizeof(struct set_fd_disp_info_request) == 24 );
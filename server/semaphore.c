@@ -38,25 +38,30 @@
 
 struct semaphore
 {
-    struct object  obj;    /* object header */
-    unsigned int   count;  /* current count */
-    unsigned int   max;    /* maximum possible count */
+    struct object  obj;        /* object header */
+    unsigned int   count;      /* current count */
+    unsigned int   max;        /* maximum possible count */
+    int           *state;      /* pointer to the count (in shared memory for fast sync) */
+    unsigned int   fast_sync;  /* fast synchronization slot, or 0 */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
 static struct object_type *semaphore_get_type( struct object *obj );
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static void semaphore_destroy( struct object *obj );
 
 static const struct object_ops semaphore_ops =
 {
     sizeof(struct semaphore),      /* size */
     semaphore_dump,                /* dump */
     semaphore_get_type,            /* get_type */
-    add_queue,                     /* add_queue */
-    remove_queue,                  /* remove_queue */
+    semaphore_add_queue,           /* add_queue */
+    semaphore_remove_queue,        /* remove_queue */
     semaphore_signaled,            /* signaled */
     semaphore_satisfied,           /* satisfied */
     semaphore_signal,              /* signal */
@@ -69,7 +74,7 @@ static const struct object_ops semaphore_ops =
     default_unlink_name,           /* unlink_name */
     no_open_file,                  /* open_file */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
 
@@ -91,30 +96,45 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            sem->state = (int *)&sem->count;
+            if ((sem->fast_sync = alloc_fast_sync_slot( initial, max )))
+                sem->state = get_fast_sync_state( sem->fast_sync );
         }
     }
     return sem;
 }
 
+/* retrieve the fast synchronization slot of a semaphore object */
+enum fast_sync_type get_semaphore_fast_sync( struct object *obj, unsigned int *index )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+
+    if (obj->ops != &semaphore_ops || !sem->fast_sync) return FAST_SYNC_NONE;
+    *index = sem->fast_sync;
+    return FAST_SYNC_SEMAPHORE;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
-    if (prev) *prev = sem->count;
-    if (sem->count + count < sem->count || sem->count + count > sem->max)
-    {
-        set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
-        return 0;
-    }
-    else if (sem->count)
-    {
-        /* there cannot be any thread to wake up if the count is != 0 */
-        sem->count += count;
-    }
-    else
+    unsigned int cur;
+
+    /* the count may be modified concurrently by clients when in shared memory */
+    do
     {
-        sem->count = count;
-        wake_up( &sem->obj, count );
-    }
+        cur = *sem->state;
+        if (cur + count < cur || cur + count > sem->max)
+        {
+            if (prev) *prev = cur;
+            set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
+            return 0;
+        }
+    } while (interlocked_cmpxchg( sem->state, cur + count, cur ) != cur);
+
+    if (prev) *prev = cur;
+    if (sem->fast_sync) wake_fast_sync_slot( sem->fast_sync );
+    /* there cannot be any thread to wake up if the count was != 0 */
+    if (!cur) wake_up( &sem->obj, count );
     return 1;
 }
 
@@ -122,7 +142,8 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d\n", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d%s\n", *sem->state, sem->max,
+             sem->fast_sync ? " fast" : "" );
 }
 
 static struct object_type *semaphore_get_type( struct object *obj )
@@ -136,17 +157,38 @@ static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entr
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    /* a wait on a semaphore in shared memory takes the count right away, since
+     * a client could take it before the wait is satisfied; wait-all acquires it later */
+    if (sem->fast_sync && get_wait_queue_select_op( entry ) != SELECT_WAIT_ALL)
+        return acquire_fast_sync_slot( sem->fast_sync, FAST_SYNC_SEMAPHORE );
+    return (*sem->state > 0);
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) return;  /* already taken in shared memory */
     assert( sem->count );
     sem->count--;
 }
 
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) add_fast_sync_waiter( sem->fast_sync );
+    return add_queue( obj, entry );
+}
+
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) remove_fast_sync_waiter( sem->fast_sync );
+    remove_queue( obj, entry );
+}
+
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access )
 {
     if (access & GENERIC_READ)    access |= STANDARD_RIGHTS_READ | SEMAPHORE_QUERY_STATE;
@@ -169,6 +211,13 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+static void semaphore_destroy( struct object *obj )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    free_fast_sync_slot( sem->fast_sync );
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -223,7 +272,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = *sem->state;
         reply->max = sem->max;
         release_object( sem );
     }
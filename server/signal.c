@@ -179,6 +179,7 @@ static void sighup_callback(void)
 #ifdef DEBUG_OBJECTS
     dump_objects();
 #endif
+    if (request_stats) dump_request_stats();
 }
 
 /* SIGTERM callback */
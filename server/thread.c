@@ -689,7 +689,8 @@ static int check_wait( struct thread *thread )
          * want to do something when signaled, even if others are not */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
-        if (!not_ok) return STATUS_WAIT_0;
+        /* objects in shared memory are only taken once they are all signaled */
+        if (!not_ok && acquire_fast_sync_wait_all( wait->queues, wait->count )) return STATUS_WAIT_0;
     }
     else
     {
@@ -870,6 +870,25 @@ static void dump_varargs_rectangles( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+static void dump_varargs_completion_msgs( const char *prefix, data_size_t size )
+{
+    const completion_msg_t *msg = cur_data;
+    data_size_t len = size / sizeof(*msg);
+
+    fprintf( stderr,"%s{", prefix );
+    while (len > 0)
+    {
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%08x}", msg->status );
+        msg++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 static void dump_varargs_message_data( const char *prefix, data_size_t size )
 {
     /* FIXME: dump the structured data */
@@ -1733,6 +1752,32 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_fast_sync_region_request( const struct get_fast_sync_region_request *req )
+{
+}
+
+static void dump_get_fast_sync_region_reply( const struct get_fast_sync_region_reply *req )
+{
+    fprintf( stderr, " size=%u", req->size );
+}
+
+static void dump_get_fast_sync_obj_request( const struct get_fast_sync_obj_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fast_sync_obj_reply( const struct get_fast_sync_obj_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+    fprintf( stderr, ", type=%d", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_wake_fast_sync_obj_request( const struct wake_fast_sync_obj_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2272,6 +2317,7 @@ static void dump_get_mapping_info_reply( const struct get_mapping_info_reply *re
     dump_uint64( " size=", &req->size );
     fprintf( stderr, ", flags=%08x", req->flags );
     fprintf( stderr, ", shared_file=%04x", req->shared_file );
+    fprintf( stderr, ", image_file=%04x", req->image_file );
     dump_varargs_pe_image_info( ", image=", cur_size );
 }
 
@@ -2572,6 +2618,15 @@ static void dump_set_registry_notification_request( const struct set_registry_no
     fprintf( stderr, ", filter=%08x", req->filter );
 }
 
+static void dump_get_registry_generation_request( const struct get_registry_generation_request *req )
+{
+}
+
+static void dump_get_registry_generation_reply( const struct get_registry_generation_reply *req )
+{
+    fprintf( stderr, " size=%u", req->size );
+}
+
 static void dump_create_timer_request( const struct create_timer_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -4360,6 +4415,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completion_msgs( " msgs=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4383,6 +4448,10 @@ static void dump_add_fd_completion_request( const struct add_fd_completion_reque
     dump_uint64( ", cvalue=", &req->cvalue );
     dump_uint64( ", information=", &req->information );
     fprintf( stderr, ", status=%08x", req->status );
+    fprintf( stderr, ", event=%04x", req->event );
+    dump_uint64( ", apc=", &req->apc );
+    dump_uint64( ", apc_arg=", &req->apc_arg );
+    dump_uint64( ", iosb=", &req->iosb );
 }
 
 static void dump_set_fd_disp_info_request( const struct set_fd_disp_info_request *req )
@@ -4572,6 +4641,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_fast_sync_region_request,
+    (dump_func)dump_get_fast_sync_obj_request,
+    (dump_func)dump_wake_fast_sync_obj_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -4647,6 +4719,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_unload_registry_request,
     (dump_func)dump_save_registry_request,
     (dump_func)dump_set_registry_notification_request,
+    (dump_func)dump_get_registry_generation_request,
     (dump_func)dump_create_timer_request,
     (dump_func)dump_open_timer_request,
     (dump_func)dump_set_timer_request,
@@ -4800,6 +4873,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4864,6 +4938,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_fast_sync_region_reply,
+    (dump_func)dump_get_fast_sync_obj_reply,
+    NULL,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -4939,6 +5016,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    (dump_func)dump_get_registry_generation_reply,
     (dump_func)dump_create_timer_reply,
     (dump_func)dump_open_timer_reply,
     (dump_func)dump_set_timer_reply,
@@ -5092,6 +5170,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -5156,6 +5235,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_fast_sync_region",
+    "get_fast_sync_obj",
+    "wake_fast_sync_obj",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -5231,6 +5313,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "unload_registry",
     "save_registry",
     "set_registry_notification",
+    "get_registry_generation",
     "create_timer",
     "open_timer",
     "set_timer",
@@ -5384,6 +5467,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
@@ -5549,6 +5633,11 @@ static const char *get_status_name( unsigned int status )
     return buffer;
 }
 
+const char *get_req_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
+
 void trace_request(void)
 {
     enum request req = current->req.request_header.req;
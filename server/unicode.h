@@ -33,6 +33,15 @@ static inline WCHAR *strdupW( const WCHAR *str )
     return memdup( str, len );
 }
 
+/* compute a case-insensitive hash of a string (FNV-1a on the lowercased chars) */
+static inline unsigned int hash_strW( const WCHAR *str, data_size_t len )
+{
+    unsigned int i, hash = 0x811c9dc5;
+
+    for (i = 0; i < len / sizeof(WCHAR); i++) hash = (hash ^ tolowerW( str[i] )) * 0x01000193;
+    return hash;
+}
+
 extern int parse_strW( WCHAR *buffer, data_size_t *len, const char *src, char endchar );
 extern int dump_strW( const WCHAR *str, data_size_t len, FILE *f, const char escape[2] );
 